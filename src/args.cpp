@@ -9,6 +9,45 @@ DDNNFArgs::~DDNNFArgs(){
     if(output_file != nullptr){
         delete output_file;
     }
+    if(cardinality_file != nullptr){
+        delete cardinality_file;
+    }
+    if(equivalence_file != nullptr){
+        delete equivalence_file;
+    }
+    if(entailment_file != nullptr){
+        delete entailment_file;
+    }
+    if(consistency_file != nullptr){
+        delete consistency_file;
+    }
+    if(output_compression != nullptr){
+        delete output_compression;
+    }
+    if(reorder != nullptr){
+        delete reorder;
+    }
+    if(variable_map_file != nullptr){
+        delete variable_map_file;
+    }
+    if(stats_file != nullptr){
+        delete stats_file;
+    }
+    if(tape_file != nullptr){
+        delete tape_file;
+    }
+    if(cpp_file != nullptr){
+        delete cpp_file;
+    }
+    if(update_file != nullptr){
+        delete update_file;
+    }
+    if(cache_directory != nullptr){
+        delete cache_directory;
+    }
+    if(forest_root != nullptr){
+        delete forest_root;
+    }
 }
 
 DDNNFArgs::DDNNFArgs(int argc, char** argv) {
@@ -16,7 +55,32 @@ DDNNFArgs::DDNNFArgs(int argc, char** argv) {
     output_file = nullptr;
     input_format = NONE_TYPE;
     output_format = NONE_TYPE;
+    output_compression = nullptr;
     conditions = std::set<int>();
+    smooth = false;
+    cardinality_file = nullptr;
+    equivalence_file = nullptr;
+    equivalence_format = NONE_TYPE;
+    equivalence_trials = 2;
+    entailment_file = nullptr;
+    consistency_file = nullptr;
+    model_count = false;
+    model_count_bits = 0;
+    threads = 1;
+    pipeline = false;
+    reorder = nullptr;
+    variable_map_file = nullptr;
+    stats_file = nullptr;
+    tape_file = nullptr;
+    cpp_file = nullptr;
+    update_file = nullptr;
+    cache_directory = nullptr;
+    cache_size = 1024;
+    forest_root = nullptr;
+    conjunction_files = std::vector<std::string>();
+    conjunction_formats = std::vector<ddnnf_file_format>();
+    conjunction_offset = false;
+    out_of_core_budget = 0;
     // check args by matching with all possible values:
     // not the most efficient solution, 
     // but no need to optimize since the amount of options is low
@@ -74,6 +138,65 @@ DDNNFArgs::DDNNFArgs(int argc, char** argv) {
             i++;
             continue;
         }
+        // -i_bin
+        if(current_arg == "-i_bin"){
+            if(input_file != nullptr){
+                std::cerr << "Error: Multiple input files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing input file" << std::endl;
+                exit(1);
+            }
+            input_file = new std::string(argv[i+1]);
+            input_format = BINARY_FILE_TYPE;
+            i++;
+            continue;
+        }
+        // -i_tape
+        if(current_arg == "-i_tape"){
+            if(input_file != nullptr){
+                std::cerr << "Error: Multiple input files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing input file" << std::endl;
+                exit(1);
+            }
+            input_file = new std::string(argv[i+1]);
+            input_format = TAPE_FILE_TYPE;
+            i++;
+            continue;
+        }
+        // -i_forest
+        if(current_arg == "-i_forest"){
+            if(input_file != nullptr){
+                std::cerr << "Error: Multiple input files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing input file" << std::endl;
+                exit(1);
+            }
+            input_file = new std::string(argv[i+1]);
+            input_format = FOREST_FILE_TYPE;
+            i++;
+            continue;
+        }
+        // -root
+        if(current_arg == "-root"){
+            if(forest_root != nullptr){
+                std::cerr << "Error: Multiple roots specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing root name" << std::endl;
+                exit(1);
+            }
+            forest_root = new std::string(argv[i+1]);
+            i++;
+            continue;
+        }
         // OUTPUT ARGS
         // -o
         if(current_arg == "-o"){
@@ -120,6 +243,39 @@ DDNNFArgs::DDNNFArgs(int argc, char** argv) {
             i++;
             continue;
         }
+        // -o_bin
+        if(current_arg == "-o_bin"){
+            if(output_file != nullptr){
+                std::cerr << "Error: Multiple output files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing output file" << std::endl;
+                exit(1);
+            }
+            output_file = new std::string(argv[i+1]);
+            output_format = BINARY_FILE_TYPE;
+            i++;
+            continue;
+        }
+        // -o_compress
+        if(current_arg == "-o_compress"){
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing output compression" << std::endl;
+                exit(1);
+            }
+            std::string compression = std::string(argv[i+1]);
+            if(compression != "gzip" && compression != "zstd" && compression != "none"){
+                std::cerr << "Error: Invalid output compression " << compression << std::endl;
+                exit(1);
+            }
+            if(output_compression != nullptr){
+                delete output_compression;
+            }
+            output_compression = new std::string(compression);
+            i++;
+            continue;
+        }
         // CONDITIONING ARG
         // -c
         if(current_arg == "-c"){
@@ -163,6 +319,309 @@ DDNNFArgs::DDNNFArgs(int argc, char** argv) {
             i--;
             continue;
         }
+        // TRANSFORMATION ARGS
+        // -smooth
+        if(current_arg == "-smooth"){
+            smooth = true;
+            continue;
+        }
+        // QUERY ARGS
+        // -mc
+        if(current_arg == "-mc"){
+            model_count = true;
+            continue;
+        }
+        // -mc_bits
+        if(current_arg == "-mc_bits"){
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing model count bit bound" << std::endl;
+                exit(1);
+            }
+            try{
+                model_count_bits = std::stoi(std::string(argv[i+1]));
+            }catch(std::invalid_argument& e){
+                std::cerr << "Error: Invalid model count bit bound " << argv[i+1] << std::endl;
+                exit(1);
+            }
+            if(model_count_bits < 1){
+                std::cerr << "Error: Invalid model count bit bound " << argv[i+1] << std::endl;
+                exit(1);
+            }
+            model_count = true;
+            i++;
+            continue;
+        }
+        // -card
+        if(current_arg == "-card"){
+            if(cardinality_file != nullptr){
+                std::cerr << "Error: Multiple cardinality files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing cardinality file" << std::endl;
+                exit(1);
+            }
+            cardinality_file = new std::string(argv[i+1]);
+            i++;
+            continue;
+        }
+        // -eq, -eq_c2d, -eq_d4
+        if((current_arg == "-eq")||(current_arg == "-eq_c2d")||(current_arg == "-eq_d4")){
+            if(equivalence_file != nullptr){
+                std::cerr << "Error: Multiple equivalence files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing equivalence file" << std::endl;
+                exit(1);
+            }
+            equivalence_file = new std::string(argv[i+1]);
+            if(current_arg == "-eq"){
+                equivalence_format = DDNNF_FILE_TYPE;
+            }else if(current_arg == "-eq_c2d"){
+                equivalence_format = C2D_FILE_TYPE;
+            }else{
+                equivalence_format = D4_FILE_TYPE;
+            }
+            i++;
+            continue;
+        }
+        // -and, -and_c2d, -and_d4 and -and_bin can be repeated
+        if((current_arg == "-and")||(current_arg == "-and_c2d")||(current_arg == "-and_d4")||(current_arg == "-and_bin")){
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing file to conjoin" << std::endl;
+                exit(1);
+            }
+            conjunction_files.push_back(std::string(argv[i+1]));
+            if(current_arg == "-and"){
+                conjunction_formats.push_back(DDNNF_FILE_TYPE);
+            }else if(current_arg == "-and_c2d"){
+                conjunction_formats.push_back(C2D_FILE_TYPE);
+            }else if(current_arg == "-and_d4"){
+                conjunction_formats.push_back(D4_FILE_TYPE);
+            }else{
+                conjunction_formats.push_back(BINARY_FILE_TYPE);
+            }
+            i++;
+            continue;
+        }
+        // -and_offset
+        if(current_arg == "-and_offset"){
+            conjunction_offset = true;
+            continue;
+        }
+        // -eq_trials
+        if(current_arg == "-eq_trials"){
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing number of equivalence trials" << std::endl;
+                exit(1);
+            }
+            try{
+                equivalence_trials = std::stoi(std::string(argv[i+1]));
+            }catch(std::invalid_argument& e){
+                std::cerr << "Error: Invalid number of equivalence trials " << argv[i+1] << std::endl;
+                exit(1);
+            }
+            if(equivalence_trials < 1){
+                std::cerr << "Error: Invalid number of equivalence trials " << argv[i+1] << std::endl;
+                exit(1);
+            }
+            i++;
+            continue;
+        }
+        // -entail
+        if(current_arg == "-entail"){
+            if(entailment_file != nullptr){
+                std::cerr << "Error: Multiple clause files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing clause file" << std::endl;
+                exit(1);
+            }
+            entailment_file = new std::string(argv[i+1]);
+            i++;
+            continue;
+        }
+        // -consistent
+        if(current_arg == "-consistent"){
+            if(consistency_file != nullptr){
+                std::cerr << "Error: Multiple term files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing term file" << std::endl;
+                exit(1);
+            }
+            consistency_file = new std::string(argv[i+1]);
+            i++;
+            continue;
+        }
+        // PERFORMANCE ARGS
+        // -t
+        if(current_arg == "-t"){
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing number of threads" << std::endl;
+                exit(1);
+            }
+            try{
+                threads = std::stoi(std::string(argv[i+1]));
+            }catch(std::invalid_argument& e){
+                std::cerr << "Error: Invalid number of threads " << argv[i+1] << std::endl;
+                exit(1);
+            }
+            if(threads < 1){
+                std::cerr << "Error: Invalid number of threads " << argv[i+1] << std::endl;
+                exit(1);
+            }
+            i++;
+            continue;
+        }
+        // -pipeline
+        if(current_arg == "-pipeline"){
+            pipeline = true;
+            continue;
+        }
+        // -compact
+        if(current_arg == "-compact"){
+            if(variable_map_file != nullptr){
+                std::cerr << "Error: Multiple variable map files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing variable map file" << std::endl;
+                exit(1);
+            }
+            variable_map_file = new std::string(argv[i+1]);
+            i++;
+            continue;
+        }
+        // -reorder
+        if(current_arg == "-reorder"){
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing node order" << std::endl;
+                exit(1);
+            }
+            std::string order = std::string(argv[i+1]);
+            if(order != "dfs" && order != "level" && order != "bfs" && order != "bisect" && order != "auto"){
+                std::cerr << "Error: Invalid node order " << order << std::endl;
+                exit(1);
+            }
+            if(reorder != nullptr){
+                delete reorder;
+            }
+            reorder = new std::string(order);
+            i++;
+            continue;
+        }
+        // --stats (or -stats)
+        if((current_arg == "--stats")||(current_arg == "-stats")){
+            if(stats_file != nullptr){
+                std::cerr << "Error: Multiple stats files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing stats file" << std::endl;
+                exit(1);
+            }
+            stats_file = new std::string(argv[i+1]);
+            i++;
+            continue;
+        }
+        // -tape
+        if(current_arg == "-tape"){
+            if(tape_file != nullptr){
+                std::cerr << "Error: Multiple tape files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing tape file" << std::endl;
+                exit(1);
+            }
+            tape_file = new std::string(argv[i+1]);
+            i++;
+            continue;
+        }
+        // -updates
+        if(current_arg == "-updates"){
+            if(update_file != nullptr){
+                std::cerr << "Error: Multiple update files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing update file" << std::endl;
+                exit(1);
+            }
+            update_file = new std::string(argv[i+1]);
+            i++;
+            continue;
+        }
+        // -cpp
+        if(current_arg == "-cpp"){
+            if(cpp_file != nullptr){
+                std::cerr << "Error: Multiple source files specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing source file" << std::endl;
+                exit(1);
+            }
+            cpp_file = new std::string(argv[i+1]);
+            i++;
+            continue;
+        }
+        // -cache
+        if(current_arg == "-cache"){
+            if(cache_directory != nullptr){
+                std::cerr << "Error: Multiple cache directories specified" << std::endl;
+                exit(1);
+            }
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing cache directory" << std::endl;
+                exit(1);
+            }
+            cache_directory = new std::string(argv[i+1]);
+            i++;
+            continue;
+        }
+        // -cache_size
+        if(current_arg == "-cache_size"){
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing cache size" << std::endl;
+                exit(1);
+            }
+            try{
+                cache_size = std::stol(std::string(argv[i+1]));
+            }catch(std::exception& e){
+                std::cerr << "Error: Invalid cache size " << argv[i+1] << std::endl;
+                exit(1);
+            }
+            if(cache_size < 1){
+                std::cerr << "Error: Invalid cache size " << argv[i+1] << std::endl;
+                exit(1);
+            }
+            i++;
+            continue;
+        }
+        // -ooc
+        if(current_arg == "-ooc"){
+            if(i+1 >= argc){
+                std::cerr << "Error: Missing memory budget" << std::endl;
+                exit(1);
+            }
+            try{
+                out_of_core_budget = std::stol(std::string(argv[i+1]));
+            }catch(std::exception& e){
+                std::cerr << "Error: Invalid memory budget " << argv[i+1] << std::endl;
+                exit(1);
+            }
+            if(out_of_core_budget < 1){
+                std::cerr << "Error: Invalid memory budget " << argv[i+1] << std::endl;
+                exit(1);
+            }
+            i++;
+            continue;
+        }
         // ERROR INVALID ARGUMENT
         std::cerr << "Error: Invalid option " << current_arg << std::endl;
         std::cerr << "Use -h to get a list of all options" << std::endl;
@@ -174,6 +633,78 @@ DDNNFArgs::DDNNFArgs(int argc, char** argv) {
         std::cerr << "Use -h to get a list of all options" << std::endl;
         exit(1);
     }
+    int standard_inputs = (*input_file == "-") + (equivalence_file != nullptr && *equivalence_file == "-");
+    for(const std::string& file: conjunction_files){
+        standard_inputs += file == "-";
+    }
+    if(standard_inputs > 1){
+        std::cerr << "Error: Standard input can only be read once" << std::endl;
+        exit(1);
+    }
+    if(cardinality_file != nullptr && output_file != nullptr && *cardinality_file == "-" && *output_file == "-"){
+        std::cerr << "Error: Standard output can only be written once" << std::endl;
+        exit(1);
+    }
+    if(conjunction_offset && conjunction_files.empty()){
+        std::cerr << "Error: -and_offset requires circuits to conjoin" << std::endl;
+        exit(1);
+    }
+    if(!conjunction_files.empty() && (cache_directory != nullptr || out_of_core_budget > 0 || input_format == TAPE_FILE_TYPE || input_format == FOREST_FILE_TYPE)){
+        // the conjunction is built in memory from circuits the cache key does not cover
+        std::cerr << "Error: -and cannot be used with -cache, -ooc, -i_tape or -i_forest" << std::endl;
+        exit(1);
+    }
+    if(out_of_core_budget > 0){
+        // the circuit is never loaded, only conditioning can be done
+        if(output_format != BINARY_FILE_TYPE || *output_file == "-"){
+            std::cerr << "Error: -ooc writes its result to a file given with -o_bin" << std::endl;
+            exit(1);
+        }
+        if(input_format == D4_FILE_TYPE || *input_file == "-"){
+            std::cerr << "Error: -ooc reads binary, c2d or library nnf files" << std::endl;
+            exit(1);
+        }
+        if(smooth || reorder != nullptr || variable_map_file != nullptr || stats_file != nullptr || tape_file != nullptr || cpp_file != nullptr || update_file != nullptr || cache_directory != nullptr || model_count || cardinality_file != nullptr || equivalence_file != nullptr || entailment_file != nullptr || consistency_file != nullptr){
+            std::cerr << "Error: -ooc only supports conditioning" << std::endl;
+            exit(1);
+        }
+    }
+    if(cache_directory != nullptr && *input_file == "-"){
+        // the key is a hash of the whole input file
+        std::cerr << "Error: -cache cannot be used with standard input" << std::endl;
+        exit(1);
+    }
+    if(input_format == TAPE_FILE_TYPE){
+        // a tape can only be evaluated
+        if(output_file != nullptr || conditions.size() > 0 || smooth || reorder != nullptr || variable_map_file != nullptr || tape_file != nullptr || update_file != nullptr || cache_directory != nullptr || cardinality_file != nullptr || equivalence_file != nullptr || out_of_core_budget > 0){
+            std::cerr << "Error: -i_tape only supports -mc, -entail, -consistent and -cpp" << std::endl;
+            exit(1);
+        }
+        if(*input_file == "-"){
+            std::cerr << "Error: -i_tape cannot read standard input" << std::endl;
+            exit(1);
+        }
+    }
+    if(forest_root != nullptr && input_format != FOREST_FILE_TYPE){
+        std::cerr << "Error: -root requires -i_forest" << std::endl;
+        exit(1);
+    }
+    if(input_format == FOREST_FILE_TYPE){
+        // circuits are conditioned, counted and written one root at a time
+        if(smooth || reorder != nullptr || variable_map_file != nullptr || tape_file != nullptr || cpp_file != nullptr || update_file != nullptr || cache_directory != nullptr || cardinality_file != nullptr || equivalence_file != nullptr || entailment_file != nullptr || consistency_file != nullptr || out_of_core_budget > 0){
+            std::cerr << "Error: -i_forest only supports -c, -mc, -root and output files" << std::endl;
+            exit(1);
+        }
+        if(*input_file == "-"){
+            std::cerr << "Error: -i_forest cannot read standard input" << std::endl;
+            exit(1);
+        }
+        // without -root the whole forest is written
+        if(forest_root == nullptr && output_file != nullptr && output_format != DDNNF_FILE_TYPE){
+            std::cerr << "Error: -i_forest writes the forest with -o, or one circuit given with -root" << std::endl;
+            exit(1);
+        }
+    }
 }
 
 void print_help(std::string command){
@@ -186,12 +717,51 @@ void print_help(std::string command){
     std::cout << "-i <input_file>\tSpecify input file, input is expected in library nnf format" << std::endl;
     std::cout << "-i_d4 <input_file>\tSpecify input file, input is expected in c2d nnf format" << std::endl;
     std::cout << "-i_c2d <input_file>\tSpecify input file, input is expected in d4 nnf format" << std::endl;
+    std::cout << "-i_bin <input_file>\tSpecify input file, input is expected in binary nnf format" << std::endl;
+    std::cout << "-i_tape <input_file>\tSpecify input file, input is an evaluation tape saved with -tape (queries and -cpp only)" << std::endl;
+    std::cout << "-i_forest <input_file>\tSpecify input file, input is a forest saved with -i_forest ... -o, or a list of \"<name> <format> <file>\" lines (format nnf, c2d, d4 or bin, # starts a comment line) loaded into one forest sharing equal nodes" << std::endl;
+    std::cout << "-root <name>\t\tWith -i_forest, only condition and count the circuit <name> and write it as a single circuit" << std::endl;
+    std::cout << "Use - as input file to read the circuit from standard input" << std::endl;
     std::cout << "OUTPUT OPTIONS:" << std::endl;
     std::cout << "-o <output_file>\tSpecify output file, output will be saved in library nnf format" << std::endl;
     std::cout << "-o_c2d <output_file>\tSpecify output file, output will be saved in c2d nnf format" << std::endl;
     std::cout << "-o_d4 <output_file>\tSpecify output file, output will be saved in d4 nnf format" << std::endl;
+    std::cout << "-o_bin <output_file>\tSpecify output file, output will be saved in binary nnf format" << std::endl;
+    std::cout << "Use - as output file to write the circuit to standard output, query results are then printed to standard error" << std::endl;
+    std::cout << "-o_compress <format>\tCompress the output file with gzip, zstd or none (default: from the .gz or .zst extension)" << std::endl;
+    std::cout << "Input files compressed with gzip or zstd are recognized and decompressed automatically" << std::endl;
+    std::cout << "CONJUNCTION OPTIONS:" << std::endl;
+    std::cout << "-and <file>\t\tConjoin the input with a circuit in library nnf format over other variables, can be repeated" << std::endl;
+    std::cout << "-and_c2d <file>\t\tSame as -and, for a circuit in c2d nnf format" << std::endl;
+    std::cout << "-and_d4 <file>\t\tSame as -and, for a circuit in d4 nnf format" << std::endl;
+    std::cout << "-and_bin <file>\t\tSame as -and, for a circuit in binary nnf format" << std::endl;
+    std::cout << "-and_offset\t\tRename the variables of every conjoined circuit to follow those of the circuits before it, instead of requiring disjoint variables" << std::endl;
     std::cout << "CONDITIONING OPTION:" << std::endl;
     std::cout << "-c <var1> <var2> ... <varN>\tSpecify variables to condition" << std::endl;
+    std::cout << "TRANSFORMATION OPTIONS:" << std::endl;
+    std::cout << "-smooth\t\t\tSmooth the formula after conditioning, so that all children of OR nodes mention the same variables" << std::endl;
+    std::cout << "-compact <map_file>\tRename the variables of the output circuit to 1..m, saving one \"new original\" line for each variable" << std::endl;
+    std::cout << "QUERY OPTIONS:" << std::endl;
+    std::cout << "-mc\t\t\tPrint the exact model count, computed modulo several primes" << std::endl;
+    std::cout << "-mc_bits <bits>\t\tSame as -mc, assuming the model count has at most <bits> bits" << std::endl;
+    std::cout << "-card <output_file>\tSave the number of models with exactly k true variables, one \"k count\" line for each k (- prints it)" << std::endl;
+    std::cout << "-eq <file>\t\tCheck equivalence with a second circuit in library nnf format" << std::endl;
+    std::cout << "-eq_c2d <file>\t\tCheck equivalence with a second circuit in c2d nnf format" << std::endl;
+    std::cout << "-eq_d4 <file>\t\tCheck equivalence with a second circuit in d4 nnf format" << std::endl;
+    std::cout << "-eq_trials <n>\t\tNumber of random evaluations used by the equivalence check (default 2)" << std::endl;
+    std::cout << "-entail <clause_file>\tFor each clause in the file (one per line, 0 terminated) print 1 if it is entailed, 0 otherwise" << std::endl;
+    std::cout << "-consistent <term_file>\tFor each term in the file (one per line, 0 terminated) print 1 if it is consistent, 0 otherwise" << std::endl;
+    std::cout << "-updates <update_file>\tApply \"w <var> <weight>\", \"e <literal>\" (evidence) and \"r <var>\" (remove evidence) lines incrementally, printing the weighted count modulo the largest prime below 2^62 at each \"q\" line (weights start at 1/2)" << std::endl;
+    std::cout << "PERFORMANCE OPTIONS:" << std::endl;
+    std::cout << "-t <threads>\t\tNumber of threads used to load files, condition and answer queries (default 1)" << std::endl;
+    std::cout << "-pipeline		Read and write files on background threads, overlapping disk access with parsing and formatting" << std::endl;
+    std::cout << "-reorder <order>\tRenumber the nodes as dfs, level, bfs, bisect or auto (smallest average edge span) before answering queries" << std::endl;
+    std::cout << "-tape <tape_file>\tSave the final circuit as an evaluation tape, to answer later queries with -i_tape" << std::endl;
+    std::cout << "-cpp <source_file>\tSave C++ source evaluating the final circuit as straight line code (probability and weighted count modulo a prime), to build as a shared object" << std::endl;
+    std::cout << "--stats <json_file>\tSave timings of every phase, simplification counters, peak memory and allocations (counted in builds made with COUNT_ALLOCATIONS=1, -1 otherwise) as JSON" << std::endl;
+    std::cout << "-cache <directory>\tReuse the circuit read and conditioned by an earlier run on the same input file and literals, saving it otherwise" << std::endl;
+    std::cout << "-cache_size <MiB>\tRemove the least recently used circuits once the cache exceeds <MiB> (default 1024)" << std::endl;
+    std::cout << "-ooc <MiB>\t\tCondition without loading the circuit, keeping about <MiB> of it in memory (binary, c2d or library input, -o_bin output)" << std::endl;
 }
 
 std::string DDNNFArgs::get_input_file()const{
@@ -202,6 +772,17 @@ bool DDNNFArgs::has_output_file()const{
     return output_file != nullptr;
 }
 
+bool DDNNFArgs::has_output_compression()const{
+    return output_compression != nullptr;
+}
+
+std::string DDNNFArgs::get_output_compression()const{
+    if(has_output_compression()){
+        return *output_compression;
+    }
+    return std::string("");
+}
+
 std::string DDNNFArgs::get_output_file()const{
     if(has_output_file()){
         return *output_file;
@@ -221,3 +802,191 @@ ddnnf_file_format DDNNFArgs::get_output_format()const{
 std::set<int> DDNNFArgs::get_conditions()const{
     return std::set<int>(conditions);
 }
+
+bool DDNNFArgs::has_smooth()const{
+    return smooth;
+}
+
+bool DDNNFArgs::has_model_count()const{
+    return model_count;
+}
+
+int DDNNFArgs::get_model_count_bits()const{
+    return model_count_bits;
+}
+
+bool DDNNFArgs::has_equivalence_file()const{
+    return equivalence_file != nullptr;
+}
+
+std::string DDNNFArgs::get_equivalence_file()const{
+    if(has_equivalence_file()){
+        return *equivalence_file;
+    }
+    return std::string("");
+}
+
+ddnnf_file_format DDNNFArgs::get_equivalence_format()const{
+    return equivalence_format;
+}
+
+int DDNNFArgs::get_equivalence_trials()const{
+    return equivalence_trials;
+}
+
+bool DDNNFArgs::has_entailment_file()const{
+    return entailment_file != nullptr;
+}
+
+std::string DDNNFArgs::get_entailment_file()const{
+    if(has_entailment_file()){
+        return *entailment_file;
+    }
+    return std::string("");
+}
+
+bool DDNNFArgs::has_consistency_file()const{
+    return consistency_file != nullptr;
+}
+
+std::string DDNNFArgs::get_consistency_file()const{
+    if(has_consistency_file()){
+        return *consistency_file;
+    }
+    return std::string("");
+}
+
+bool DDNNFArgs::has_cardinality_file()const{
+    return cardinality_file != nullptr;
+}
+
+std::string DDNNFArgs::get_cardinality_file()const{
+    if(has_cardinality_file()){
+        return *cardinality_file;
+    }
+    return std::string("");
+}
+
+int DDNNFArgs::get_threads()const{
+    return threads;
+}
+
+bool DDNNFArgs::has_pipeline()const{
+    return pipeline;
+}
+
+bool DDNNFArgs::has_reorder()const{
+    return reorder != nullptr;
+}
+
+std::string DDNNFArgs::get_reorder()const{
+    if(has_reorder()){
+        return *reorder;
+    }
+    return std::string("");
+}
+
+bool DDNNFArgs::has_variable_map_file()const{
+    return variable_map_file != nullptr;
+}
+
+std::string DDNNFArgs::get_variable_map_file()const{
+    if(has_variable_map_file()){
+        return *variable_map_file;
+    }
+    return std::string("");
+}
+
+bool DDNNFArgs::has_stats_file()const{
+    return stats_file != nullptr;
+}
+
+std::string DDNNFArgs::get_stats_file()const{
+    if(has_stats_file()){
+        return *stats_file;
+    }
+    return std::string("");
+}
+
+bool DDNNFArgs::has_out_of_core()const{
+    return out_of_core_budget > 0;
+}
+
+bool DDNNFArgs::has_tape_file()const{
+    return tape_file != nullptr;
+}
+
+std::string DDNNFArgs::get_tape_file()const{
+    if(has_tape_file()){
+        return *tape_file;
+    }
+    return std::string("");
+}
+
+bool DDNNFArgs::has_cpp_file()const{
+    return cpp_file != nullptr;
+}
+
+std::string DDNNFArgs::get_cpp_file()const{
+    if(has_cpp_file()){
+        return *cpp_file;
+    }
+    return std::string("");
+}
+
+bool DDNNFArgs::has_update_file()const{
+    return update_file != nullptr;
+}
+
+std::string DDNNFArgs::get_update_file()const{
+    if(has_update_file()){
+        return *update_file;
+    }
+    return std::string("");
+}
+
+bool DDNNFArgs::has_cache()const{
+    return cache_directory != nullptr;
+}
+
+std::string DDNNFArgs::get_cache_directory()const{
+    if(has_cache()){
+        return *cache_directory;
+    }
+    return std::string("");
+}
+
+uint64_t DDNNFArgs::get_cache_size()const{
+    return (uint64_t)cache_size << 20;
+}
+
+size_t DDNNFArgs::get_out_of_core_budget()const{
+    return (size_t)out_of_core_budget << 20;
+}
+
+bool DDNNFArgs::has_forest_root()const{
+    return forest_root != nullptr;
+}
+
+std::string DDNNFArgs::get_forest_root()const{
+    if(has_forest_root()){
+        return *forest_root;
+    }
+    return std::string("");
+}
+
+bool DDNNFArgs::has_conjunction()const{
+    return !conjunction_files.empty();
+}
+
+std::vector<std::string> DDNNFArgs::get_conjunction_files()const{
+    return std::vector<std::string>(conjunction_files);
+}
+
+std::vector<ddnnf_file_format> DDNNFArgs::get_conjunction_formats()const{
+    return std::vector<ddnnf_file_format>(conjunction_formats);
+}
+
+bool DDNNFArgs::has_conjunction_offset()const{
+    return conjunction_offset;
+}
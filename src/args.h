@@ -2,12 +2,17 @@
 #define __ARGS_DDNNF_H__
 #include <string>
 #include <set>
+#include <vector>
 #include <iostream>
+#include <cstdint>
 
 enum ddnnf_file_format {
     C2D_FILE_TYPE,
     D4_FILE_TYPE,
     DDNNF_FILE_TYPE,
+    BINARY_FILE_TYPE,
+    TAPE_FILE_TYPE,
+    FOREST_FILE_TYPE,
     NONE_TYPE
 };
 
@@ -17,16 +22,81 @@ class DDNNFArgs{
     std::string* output_file;
     ddnnf_file_format input_format;
     ddnnf_file_format output_format;
+    std::string* output_compression;
     std::set<int> conditions;
+    bool smooth;
+    std::string* cardinality_file;
+    std::string* equivalence_file;
+    std::string* entailment_file;
+    std::string* consistency_file;
+    ddnnf_file_format equivalence_format;
+    int equivalence_trials;
+    bool model_count;
+    int model_count_bits;
+    int threads;
+    bool pipeline;
+    std::string* reorder;
+    std::string* variable_map_file;
+    std::string* stats_file;
+    std::string* tape_file;
+    std::string* cpp_file;
+    std::string* update_file;
+    std::string* cache_directory;
+    long cache_size; // MiB
+    std::string* forest_root;
+    std::vector<std::string> conjunction_files;
+    std::vector<ddnnf_file_format> conjunction_formats;
+    bool conjunction_offset;
+    long out_of_core_budget; // MiB, 0 when the circuit is loaded in memory
     public:
     DDNNFArgs(int argc, char** argv);
     ~DDNNFArgs();
     std::string get_input_file()const;
     std::string get_output_file()const;
     bool has_output_file()const;
+    bool has_output_compression()const;
+    std::string get_output_compression()const;
     ddnnf_file_format get_input_format()const;
     ddnnf_file_format get_output_format()const;
     std::set<int> get_conditions()const;
+    bool has_smooth()const;
+    bool has_model_count()const;
+    int get_model_count_bits()const;
+    bool has_equivalence_file()const;
+    std::string get_equivalence_file()const;
+    ddnnf_file_format get_equivalence_format()const;
+    int get_equivalence_trials()const;
+    bool has_entailment_file()const;
+    std::string get_entailment_file()const;
+    bool has_consistency_file()const;
+    std::string get_consistency_file()const;
+    bool has_cardinality_file()const;
+    std::string get_cardinality_file()const;
+    int get_threads()const;
+    bool has_pipeline()const;
+    bool has_reorder()const;
+    std::string get_reorder()const;
+    bool has_variable_map_file()const;
+    std::string get_variable_map_file()const;
+    bool has_stats_file()const;
+    std::string get_stats_file()const;
+    bool has_tape_file()const;
+    std::string get_tape_file()const;
+    bool has_cpp_file()const;
+    std::string get_cpp_file()const;
+    bool has_update_file()const;
+    std::string get_update_file()const;
+    bool has_cache()const;
+    std::string get_cache_directory()const;
+    uint64_t get_cache_size()const; // bytes
+    bool has_forest_root()const;
+    std::string get_forest_root()const;
+    bool has_conjunction()const;
+    std::vector<std::string> get_conjunction_files()const;
+    std::vector<ddnnf_file_format> get_conjunction_formats()const;
+    bool has_conjunction_offset()const;
+    bool has_out_of_core()const;
+    size_t get_out_of_core_budget()const; // bytes
 };
 
 
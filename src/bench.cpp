@@ -0,0 +1,218 @@
+#include "ddnnf.h"
+#include "binary.h"
+#include "tape.h"
+
+// timing operations
+#include <chrono>
+#include <random>
+
+// Benchmark of the loading, conditioning, counting and serialization steps on
+// synthetic circuits, usage:
+//   ddnnf_bench [results_file] [repetitions] [scale]
+// one CSV line per circuit and step is saved to results_file
+
+// size of the generated circuits at scale 1
+const int BENCH_SIZE = 20000;
+// simplification recurses along paths, deeper chains overflow the stack
+const int BENCH_MAX_DEPTH = 4000;
+
+// a generated circuit, saved in the format its reader expects
+struct BenchCircuit{
+    std::string name;
+    file_format format;
+    std::string filename;
+};
+
+// decision chain: node i is a decision on x_i between two ANDs sharing node i - 1
+void write_chain(std::ostream& out, int depth){
+    out << "nnf " << 5 * depth + 1 << " " << 6 * depth << " " << depth << "\n";
+    out << "A 0\n";
+    int previous = 0;
+    int next_id = 1;
+    for(int var = 1; var <= depth; var++){
+        out << "L " << var << "\n";
+        out << "L " << -var << "\n";
+        out << "A 2 " << next_id << " " << previous << "\n";
+        out << "A 2 " << next_id + 1 << " " << previous << "\n";
+        out << "O " << var << " 2 " << next_id + 2 << " " << next_id + 3 << "\n";
+        previous = next_id + 4;
+        next_id += 5;
+    }
+}
+
+// one OR over width mutually exclusive terms, each fixing the bits of
+// its index and one variable of its own (library format)
+void write_wide_or(std::ostream& out, int width){
+    int bits = 1;
+    while((1 << bits) < width){bits++;}
+    int total_vars = bits + width;
+    out << "nnf 0 0 " << total_vars << "\n";
+    // literals of the index bits come first, 2 per bit
+    for(int bit = 1; bit <= bits; bit++){
+        out << "L " << bit << "\n";
+        out << "L " << -bit << "\n";
+    }
+    int next_id = 2 * bits;
+    std::vector<int> terms = std::vector<int>();
+    for(int term = 0; term < width; term++){
+        out << "L " << bits + term + 1 << "\n";
+        out << "A " << bits + 1;
+        for(int bit = 1; bit <= bits; bit++){
+            bool set = (term >> (bit - 1)) & 1;
+            out << " " << 2 * (bit - 1) + (set ? 0 : 1);
+        }
+        out << " " << next_id << "\n";
+        terms.push_back(next_id + 1);
+        next_id += 2;
+    }
+    out << "O 0 " << terms.size();
+    for(int term: terms){
+        out << " " << term;
+    }
+    out << "\n";
+}
+
+// random decomposable ANDs: variable ranges are split at random points,
+// single variables become decisions x or -x
+int write_random_and_rec(std::ostream& out, int first, int last, std::mt19937& generator, int& next_id){
+    if(first == last){
+        out << "L " << first << "\n";
+        out << "L " << -first << "\n";
+        out << "O " << first << " 2 " << next_id << " " << next_id + 1 << "\n";
+        next_id += 3;
+        return next_id - 1;
+    }
+    int split = std::uniform_int_distribution<int>(first,last - 1)(generator);
+    int left = write_random_and_rec(out,first,split,generator,next_id);
+    int right = write_random_and_rec(out,split + 1,last,generator,next_id);
+    out << "A 2 " << left << " " << right << "\n";
+    return next_id++;
+}
+
+void write_random_and(std::ostream& out, int vars, unsigned seed){
+    std::mt19937 generator(seed);
+    out << "nnf 0 0 " << vars << "\n";
+    int next_id = 0;
+    write_random_and_rec(out,1,vars,generator,next_id);
+}
+
+// d4 decision chain with literal labelled edges: or node i has two
+// edges to node i + 1, labelled x_i and -x_i
+void write_d4_chain(std::ostream& out, int depth){
+    for(int node = 1; node <= depth; node++){
+        out << "o " << node << " 0\n";
+    }
+    out << "t " << depth + 1 << " 0\n";
+    for(int node = 1; node <= depth; node++){
+        out << node << " " << node + 1 << " " << node << " 0\n";
+        out << node << " " << node + 1 << " " << -node << " 0\n";
+    }
+}
+
+BenchCircuit save_circuit(const std::string& name, file_format format, const std::function<void(std::ostream&)>& write){
+    BenchCircuit circuit = BenchCircuit();
+    circuit.name = name;
+    circuit.format = format;
+    circuit.filename = temporary_file_name();
+    std::ofstream out(circuit.filename);
+    write(out);
+    out.close();
+    return circuit;
+}
+
+void read_circuit(DDNNF& ddnnf, const BenchCircuit& circuit){
+    switch(circuit.format){
+        case C2D_FILE: ddnnf.read_c2d_file(circuit.filename.c_str(),1); break;
+        case D4_FILE: ddnnf.read_d4_file(circuit.filename.c_str(),1); break;
+        default: ddnnf.read_ddnnf_file(circuit.filename.c_str(),1); break;
+    }
+}
+
+// runs step repetitions times, each after an untimed call to prepare
+// (unless null), returns the sorted times in microseconds
+std::vector<long> time_step(int repetitions, const std::function<void()>& prepare, const std::function<void()>& step){
+    std::vector<long> times = std::vector<long>();
+    for(int i = 0; i < repetitions; i++){
+        if(prepare){prepare();}
+        auto start_time = std::chrono::high_resolution_clock::now();
+        step();
+        auto end_time = std::chrono::high_resolution_clock::now();
+        times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count());
+    }
+    std::sort(times.begin(),times.end());
+    return times;
+}
+
+// nearest rank percentile of sorted times
+long percentile(const std::vector<long>& times, int percent){
+    size_t rank = (times.size() * percent + 99) / 100;
+    return times[std::max((size_t)1,rank) - 1];
+}
+
+int main(int argc, char** argv){
+    std::string results_file = argc > 1 ? argv[1] : "bench_results.csv";
+    int repetitions = argc > 2 ? std::stoi(argv[2]) : 5;
+    int scale = argc > 3 ? std::stoi(argv[3]) : 1;
+    if(repetitions < 1 || scale < 1){
+        std::cerr << "Usage: " << argv[0] << " [results_file] [repetitions] [scale]" << std::endl;
+        return 1;
+    }
+
+    std::vector<BenchCircuit> circuits = std::vector<BenchCircuit>();
+    int depth = std::min(BENCH_MAX_DEPTH,BENCH_SIZE * scale);
+    circuits.push_back(save_circuit("chain",C2D_FILE,[&](std::ostream& out){write_chain(out,depth);}));
+    // conditioning touches every term of the wide OR once per variable
+    circuits.push_back(save_circuit("wide_or",DDNNF_FILE,[&](std::ostream& out){write_wide_or(out,BENCH_SIZE / 4 * scale);}));
+    circuits.push_back(save_circuit("random_and",C2D_FILE,[&](std::ostream& out){write_random_and(out,BENCH_SIZE * scale,42);}));
+    circuits.push_back(save_circuit("d4_chain",D4_FILE,[&](std::ostream& out){write_d4_chain(out,depth);}));
+
+    std::ofstream results(results_file);
+    if(!results){
+        std::cerr << "Error: Unable to open file " << results_file << std::endl;
+        return 1;
+    }
+    results << "circuit,nodes,edges,step,repetitions,median_us,p95_us\n";
+    std::string output = temporary_file_name();
+    for(const BenchCircuit& circuit: circuits){
+        DDNNF ddnnf = DDNNF();
+        std::map<std::string,std::vector<long>> steps = std::map<std::string,std::vector<long>>();
+        std::vector<std::string> step_names = std::vector<std::string>();
+        auto add_step = [&](const std::string& name, const std::function<void()>& prepare, const std::function<void()>& step){
+            step_names.push_back(name);
+            steps[name] = time_step(repetitions,prepare,step);
+        };
+        add_step("read",nullptr,[&](){read_circuit(ddnnf,circuit);});
+        // condition on the first ten variables, alternating signs
+        std::set<int> conditions = std::set<int>();
+        for(int var = 1; var <= 10; var++){
+            conditions.insert(var % 2 == 0 ? var : -var);
+        }
+        // steps changing the circuit get their own copy, read before the
+        // clock starts so that no node is shared with ddnnf
+        DDNNF copy = DDNNF();
+        add_step("condition_all",[&](){read_circuit(copy,circuit);},[&](){copy.condition_all(conditions,1);});
+        // simplify starts from the circuit as read, not yet simplified
+        add_step("simplify",[&](){
+            copy = DDNNF();
+            copy.set_simplify_on_load(false);
+            read_circuit(copy,circuit);
+        },[&](){copy.simplify();});
+        copy = DDNNF();
+        // the same count through the circuit and through its tape
+        add_step("model_count",nullptr,[&](){ddnnf.model_count(0,1);});
+        EvaluationTape tape(ddnnf);
+        add_step("tape_model_count",nullptr,[&](){tape.model_count(0,1);});
+        add_step("serialize",nullptr,[&](){ddnnf.serialize(output.c_str());});
+        add_step("serialize_c2d",nullptr,[&](){ddnnf.serialize_c2d(output.c_str());});
+        add_step("serialize_d4",nullptr,[&](){ddnnf.serialize_d4(output.c_str());});
+        for(const std::string& name: step_names){
+            const std::vector<long>& times = steps[name];
+            results << circuit.name << "," << ddnnf.node_count() << "," << ddnnf.edge_count() << "," << name << "," << repetitions << "," << percentile(times,50) << "," << percentile(times,95) << "\n";
+            std::cerr << circuit.name << " " << name << ": median " << percentile(times,50) / 1000.0 << " ms, p95 " << percentile(times,95) / 1000.0 << " ms" << std::endl;
+        }
+        remove(circuit.filename.c_str());
+    }
+    remove(output.c_str());
+    results.close();
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "bigint.h"
+
+BigInt::BigInt(){
+    limbs = std::vector<uint32_t>();
+}
+
+BigInt::BigInt(uint64_t value){
+    limbs = std::vector<uint32_t>();
+    while(value > 0){
+        limbs.push_back((uint32_t)(value & 0xFFFFFFFFu));
+        value >>= 32;
+    }
+}
+
+// zero is always represented by an empty vector
+bool BigInt::is_zero()const{
+    return limbs.empty();
+}
+
+int BigInt::bit_length()const{
+    if(limbs.empty()){return 0;}
+    int bits = 32 * (limbs.size() - 1);
+    uint32_t top = limbs.back();
+    while(top > 0){
+        bits++;
+        top >>= 1;
+    }
+    return bits;
+}
+
+void BigInt::add(const BigInt& other){
+    if(other.limbs.size() > limbs.size()){
+        limbs.resize(other.limbs.size(),0);
+    }
+    uint64_t carry = 0;
+    for(size_t i = 0; i < limbs.size(); i++){
+        uint64_t sum = (uint64_t)limbs[i] + carry;
+        if(i < other.limbs.size()){
+            sum += other.limbs[i];
+        }
+        limbs[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    if(carry > 0){
+        limbs.push_back((uint32_t)carry);
+    }
+}
+
+void BigInt::add_small(uint64_t value){
+    add(BigInt(value));
+}
+
+void BigInt::mul_small(uint64_t value){
+    if(value == 0){
+        limbs.clear();
+        return;
+    }
+    // a 32 bit limb times a 64 bit value
+    // plus the carry always fits in 128 bits
+    unsigned __int128 carry = 0;
+    for(size_t i = 0; i < limbs.size(); i++){
+        unsigned __int128 product = (unsigned __int128)limbs[i] * value + carry;
+        limbs[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+    while(carry > 0){
+        limbs.push_back((uint32_t)carry);
+        carry >>= 32;
+    }
+}
+
+bool BigInt::operator==(const BigInt& other)const{
+    return limbs == other.limbs;
+}
+
+bool BigInt::operator!=(const BigInt& other)const{
+    return limbs != other.limbs;
+}
+
+std::string BigInt::to_string()const{
+    if(limbs.empty()){
+        return std::string("0");
+    }
+    // repeatedly divide by 10^9 and collect the remainders
+    std::vector<uint32_t> digits = limbs;
+    std::vector<uint32_t> chunks = std::vector<uint32_t>();
+    while(!digits.empty()){
+        uint64_t remainder = 0;
+        for(int i = digits.size() - 1; i >= 0; i--){
+            uint64_t current = (remainder << 32) | digits[i];
+            digits[i] = (uint32_t)(current / 1000000000u);
+            remainder = current % 1000000000u;
+        }
+        chunks.push_back((uint32_t)remainder);
+        while(!digits.empty() && digits.back() == 0){
+            digits.pop_back();
+        }
+    }
+    std::string result = std::to_string(chunks.back());
+    for(int i = chunks.size() - 2; i >= 0; i--){
+        std::string chunk = std::to_string(chunks[i]);
+        result += std::string(9 - chunk.size(),'0') + chunk;
+    }
+    return result;
+}
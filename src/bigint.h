@@ -0,0 +1,28 @@
+#ifndef __BIGINT_H__
+#define __BIGINT_H__
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Arbitrary precision non negative integer,
+// only supports the operations needed to
+// rebuild exact counts from modular residues
+class BigInt{
+    private:
+    std::vector<uint32_t> limbs; // little endian base 2^32 digits
+
+    public:
+    BigInt();
+    BigInt(uint64_t value);
+    bool is_zero()const;
+    int bit_length()const;
+    void add(const BigInt& other);
+    void add_small(uint64_t value);
+    void mul_small(uint64_t value);
+    bool operator==(const BigInt& other)const;
+    bool operator!=(const BigInt& other)const;
+    std::string to_string()const;
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "binary.h"
+#include "error.h"
+#include "stream.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+
+const char BINARY_MAGIC[8] = {'D','D','N','N','F','B','I','N'};
+const size_t EDGE_COPY_BLOCK = 1 << 20;
+// ids from here on are reserved, the out-of-core passes use them as markers
+const uint64_t MAX_BINARY_NODES = 0xFFFFFFF0u;
+
+void print_binary_error(){
+    fail("File is not in binary nnf format");
+}
+
+// creates an empty file in $TMPDIR (or /tmp), sets its path in name
+int create_temporary_file(std::string& name){
+    const char* directory = getenv("TMPDIR");
+    if(directory == nullptr || directory[0] == '\0'){directory = "/tmp";}
+    std::string path = std::string(directory) + "/ddnnf-XXXXXX";
+    std::vector<char> buffer = std::vector<char>(path.begin(),path.end());
+    buffer.push_back('\0');
+    int descriptor = mkstemp(buffer.data());
+    if(descriptor < 0){
+        fail(std::string("Unable to create a temporary file in ") + directory);
+    }
+    name = std::string(buffer.data());
+    return descriptor;
+}
+
+int open_temporary_file(){
+    std::string name;
+    int descriptor = create_temporary_file(name);
+    // the data stays reachable through the descriptor only
+    unlink(name.c_str());
+    return descriptor;
+}
+
+std::string temporary_file_name(){
+    std::string name;
+    close(create_temporary_file(name));
+    return name;
+}
+
+BinaryNodeFile::BinaryNodeFile(const char* filename) : file(filename){
+    size_t length = file.size();
+    if(length < sizeof(BinaryHeader)){print_binary_error();}
+    header = (const BinaryHeader*)file.begin();
+    if(memcmp(header->magic,BINARY_MAGIC,sizeof(BINARY_MAGIC)) != 0){print_binary_error();}
+    if(header->node_count == 0 || header->node_count > MAX_BINARY_NODES){print_binary_error();}
+    if(header->total_variables > (uint64_t)INT32_MAX || header->root_id >= header->node_count){print_binary_error();}
+    // check the sizes before computing offsets from them
+    size_t node_bytes = (header->node_count + 1) * sizeof(BinaryNode);
+    if(header->edge_count > (length - sizeof(BinaryHeader)) / sizeof(uint32_t)){print_binary_error();}
+    if(length != sizeof(BinaryHeader) + node_bytes + header->edge_count * sizeof(uint32_t)){print_binary_error();}
+    node_records = (const BinaryNode*)(file.begin() + sizeof(BinaryHeader));
+    edge_records = (const uint32_t*)(file.begin() + sizeof(BinaryHeader) + node_bytes);
+    if(node_records[0].first_edge != 0 || node_records[header->node_count].first_edge != header->edge_count){print_binary_error();}
+}
+
+uint64_t BinaryNodeFile::node_count()const{
+    return header->node_count;
+}
+
+uint64_t BinaryNodeFile::edge_count()const{
+    return header->edge_count;
+}
+
+int BinaryNodeFile::total_variables()const{
+    return (int)header->total_variables;
+}
+
+uint64_t BinaryNodeFile::root()const{
+    return header->root_id;
+}
+
+ddnnf_node_type BinaryNodeFile::type(uint64_t id)const{
+    return (ddnnf_node_type)node_records[id].type;
+}
+
+int BinaryNodeFile::var(uint64_t id)const{
+    return node_records[id].var;
+}
+
+uint64_t BinaryNodeFile::child_count(uint64_t id)const{
+    return node_records[id + 1].first_edge - node_records[id].first_edge;
+}
+
+const uint32_t* BinaryNodeFile::children(uint64_t id)const{
+    return edge_records + node_records[id].first_edge;
+}
+
+void BinaryNodeFile::check_node(uint64_t id)const{
+    const BinaryNode& node = node_records[id];
+    bool valid = node.type <= DDNNF_FALSE;
+    valid = valid && node.first_edge <= node_records[id + 1].first_edge;
+    valid = valid && node_records[id + 1].first_edge <= header->edge_count;
+    if(valid && node.type == DDNNF_LITERAL){
+        valid = node.var != 0 && (uint64_t)std::abs((int64_t)node.var) <= header->total_variables;
+    }
+    if(valid && node.type != DDNNF_AND && node.type != DDNNF_OR){
+        valid = child_count(id) == 0;
+    }
+    if(valid){
+        const uint32_t* child_ids = children(id);
+        for(uint64_t i = 0; i < child_count(id); i++){
+            // children always come before their parents
+            if(child_ids[i] >= id){
+                valid = false;
+                break;
+            }
+        }
+    }
+    if(!valid){
+        fail(std::string("Malformed node ") + std::to_string(id) + " in binary nnf file");
+    }
+}
+
+void BinaryNodeFile::release(uint64_t first, uint64_t last)const{
+    if(last > header->node_count){last = header->node_count;}
+    if(first >= last){return;}
+    file.release((const char*)(node_records + first),(const char*)(node_records + last));
+    file.release((const char*)(edge_records + node_records[first].first_edge),(const char*)(edge_records + node_records[last].first_edge));
+}
+
+BinaryNodeWriter::BinaryNodeWriter(const char* filename){
+    this->filename = std::string(filename);
+    if(is_standard_stream(this->filename)){
+        // the header is rewritten at the end, so the file must be seekable
+        fail("Binary nnf files cannot be written to standard output");
+    }
+    out.open(filename,std::ios::binary);
+    if(!out){
+        fail(std::string("Unable to open file ") + filename);
+    }
+    edges = fdopen(open_temporary_file(),"w+b");
+    if(edges == nullptr){
+        fail("Unable to create a temporary file");
+    }
+    node_count = 0;
+    edge_count = 0;
+    // placeholder, the counts are known once all nodes are written
+    BinaryHeader header = BinaryHeader();
+    out.write((const char*)&header,sizeof(header));
+}
+
+BinaryNodeWriter::~BinaryNodeWriter(){
+    if(edges != nullptr){
+        fclose(edges);
+    }
+}
+
+uint64_t BinaryNodeWriter::add_node(ddnnf_node_type type, int var, const uint32_t* children, uint64_t count){
+    if(node_count >= MAX_BINARY_NODES){
+        fail("Too many nodes for a binary nnf file");
+    }
+    BinaryNode node = BinaryNode();
+    node.type = type;
+    node.var = var;
+    node.first_edge = edge_count;
+    out.write((const char*)&node,sizeof(node));
+    if(count > 0 && fwrite(children,sizeof(uint32_t),count,edges) != count){
+        fail("Unable to write a temporary file");
+    }
+    edge_count += count;
+    return node_count++;
+}
+
+uint64_t BinaryNodeWriter::size()const{
+    return node_count;
+}
+
+void BinaryNodeWriter::finish(int total_variables, uint64_t root_id){
+    // the closing record gives the end of the last node's edges
+    BinaryNode closing = BinaryNode();
+    closing.first_edge = edge_count;
+    out.write((const char*)&closing,sizeof(closing));
+    // append the edges
+    rewind(edges);
+    std::vector<char> block = std::vector<char>(EDGE_COPY_BLOCK);
+    size_t count;
+    while((count = fread(block.data(),1,block.size(),edges)) > 0){
+        out.write(block.data(),count);
+    }
+    bool written = !ferror(edges);
+    fclose(edges);
+    edges = nullptr;
+    BinaryHeader header = BinaryHeader();
+    memcpy(header.magic,BINARY_MAGIC,sizeof(BINARY_MAGIC));
+    header.node_count = node_count;
+    header.edge_count = edge_count;
+    header.total_variables = total_variables;
+    header.root_id = root_id;
+    out.seekp(0);
+    out.write((const char*)&header,sizeof(header));
+    out.close();
+    if(!written || out.fail()){
+        fail(std::string("Unable to write file ") + filename);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef __BINARY_H__
+#define __BINARY_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include "ddnnf.h"
+#include "parser.h"
+
+// Binary circuit file, laid out so that it can be mapped and scanned
+// without being parsed:
+//   BinaryHeader
+//   node_count + 1 BinaryNode records, the last one only closes the edges
+//   edge_count uint32 child ids
+// children of node i are edges [nodes[i].first_edge, nodes[i + 1].first_edge)
+// and always have smaller ids than i, so a front to back scan sees
+// every node after its children
+struct BinaryHeader{
+    char magic[8]; // "DDNNFBIN"
+    uint64_t node_count;
+    uint64_t edge_count;
+    uint64_t total_variables;
+    uint64_t root_id;
+};
+
+struct BinaryNode{
+    uint32_t type; // a ddnnf_node_type
+    int32_t var; // literal of LITERAL nodes, decision variable of OR nodes, 0 otherwise
+    uint64_t first_edge;
+};
+
+// opens an anonymous file in $TMPDIR (or /tmp), removed once closed
+int open_temporary_file();
+// creates an empty file in $TMPDIR (or /tmp), the caller removes it
+std::string temporary_file_name();
+
+// Read only view of a mapped binary circuit file, exits if the file
+// is not a binary circuit
+class BinaryNodeFile{
+    private:
+    MappedFile file;
+    const BinaryHeader* header;
+    const BinaryNode* node_records;
+    const uint32_t* edge_records;
+
+    public:
+    BinaryNodeFile(const char* filename);
+    uint64_t node_count()const;
+    uint64_t edge_count()const;
+    int total_variables()const;
+    uint64_t root()const;
+    ddnnf_node_type type(uint64_t id)const;
+    int var(uint64_t id)const;
+    uint64_t child_count(uint64_t id)const;
+    const uint32_t* children(uint64_t id)const;
+    // exits if the node is malformed or not after its children
+    void check_node(uint64_t id)const;
+    // drops the records of nodes [first,last) and their edges from memory
+    void release(uint64_t first, uint64_t last)const;
+};
+
+// Writes a binary circuit file node by node, the edges are kept in a
+// temporary file and appended when the circuit is finished
+class BinaryNodeWriter{
+    private:
+    std::string filename;
+    std::ofstream out;
+    FILE* edges;
+    uint64_t node_count;
+    uint64_t edge_count;
+
+    public:
+    BinaryNodeWriter(const char* filename); // exits if the file cannot be created
+    BinaryNodeWriter(const BinaryNodeWriter& other) = delete;
+    BinaryNodeWriter& operator=(const BinaryNodeWriter& other) = delete;
+    ~BinaryNodeWriter();
+    // returns the id of the node, children must already be written
+    uint64_t add_node(ddnnf_node_type type, int var, const uint32_t* children, uint64_t count);
+    uint64_t size()const;
+    void finish(int total_variables, uint64_t root_id); // exits if the file could not be written
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "cache.h"
+#include "error.h"
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t HASH_BLOCK_SIZE = 1 << 20;
+// temporary and pinned files left by crashed processes are removed after an hour
+const time_t STALE_FILE_SECONDS = 3600;
+const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+uint64_t fnv_hash(uint64_t hash, const char* data, size_t size){
+    for(size_t i = 0; i < size; i++){
+        hash = (hash ^ (unsigned char)data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+std::string hex(uint64_t value){
+    char buffer[17];
+    snprintf(buffer,sizeof(buffer),"%016llx",(unsigned long long)value);
+    return std::string(buffer);
+}
+
+ResultCache::ResultCache(const std::string& directory, uint64_t max_bytes){
+    this->directory = directory;
+    this->max_bytes = max_bytes;
+    if(mkdir(directory.c_str(),0777) != 0 && errno != EEXIST){
+        fail("Unable to create cache directory " + directory);
+    }
+}
+
+std::string ResultCache::entry_name(const std::string& key)const{
+    return directory + "/" + key + ".bin";
+}
+
+std::string ResultCache::private_name(const std::string& prefix, const std::string& key)const{
+    return directory + "/" + prefix + std::to_string(getpid()) + "-" + key;
+}
+
+std::string ResultCache::key(const std::string& input_file, int input_format, const std::set<int>& conditions)const{
+    std::ifstream in(input_file,std::ios::binary);
+    if(!in){
+        fail("Unable to open file " + input_file);
+    }
+    uint64_t hash = FNV_OFFSET;
+    uint64_t size = 0;
+    std::vector<char> buffer = std::vector<char>(HASH_BLOCK_SIZE);
+    while(in){
+        in.read(buffer.data(),buffer.size());
+        hash = fnv_hash(hash,buffer.data(),in.gcount());
+        size += in.gcount();
+    }
+    // sets are sorted, which makes the literals canonical
+    std::string literals = std::to_string(input_format);
+    for(int literal: conditions){
+        literals += " " + std::to_string(literal);
+    }
+    return hex(hash) + "-" + hex(size) + "-" + hex(fnv_hash(FNV_OFFSET,literals.data(),literals.size()));
+}
+
+bool ResultCache::load(const std::string& key, DDNNF& ddnnf)const{
+    // a private link keeps the data while other processes evict the entry
+    std::string entry = entry_name(key);
+    std::string pinned = private_name("pin-",key);
+    if(link(entry.c_str(),pinned.c_str()) != 0){
+        if(errno != EEXIST){return false;}
+        // left by an earlier process with the same pid
+        unlink(pinned.c_str());
+        if(link(entry.c_str(),pinned.c_str()) != 0){return false;}
+    }
+    // the modification time orders entries for eviction
+    utimensat(AT_FDCWD,entry.c_str(),nullptr,0);
+    ddnnf.read_binary_file(pinned.c_str());
+    unlink(pinned.c_str());
+    return true;
+}
+
+void ResultCache::store(const std::string& key, const DDNNF& ddnnf)const{
+    std::string temporary = private_name("tmp-",key);
+    ddnnf.serialize_binary(temporary.c_str());
+    if(rename(temporary.c_str(),entry_name(key).c_str()) != 0){
+        unlink(temporary.c_str());
+        fail("Unable to write cache directory " + directory);
+    }
+    evict();
+}
+
+void ResultCache::evict()const{
+    // one process evicts at a time, the others skip eviction
+    std::string lock_name = directory + "/lock";
+    int lock = open(lock_name.c_str(),O_CREAT | O_RDWR,0666);
+    if(lock < 0){return;}
+    if(flock(lock,LOCK_EX | LOCK_NB) != 0){
+        close(lock);
+        return;
+    }
+    DIR* dir = opendir(directory.c_str());
+    if(dir == nullptr){
+        close(lock);
+        return;
+    }
+    std::vector<std::pair<uint64_t,std::pair<std::string,uint64_t>>> entries;
+    uint64_t total = 0;
+    time_t now = time(nullptr);
+    struct dirent* item;
+    while((item = readdir(dir)) != nullptr){
+        std::string name = item->d_name;
+        std::string path = directory + "/" + name;
+        struct stat info;
+        if(stat(path.c_str(),&info) != 0 || !S_ISREG(info.st_mode)){continue;}
+        if(name.compare(0,4,"tmp-") == 0 || name.compare(0,4,"pin-") == 0){
+            if(now - info.st_mtime > STALE_FILE_SECONDS){unlink(path.c_str());}
+            continue;
+        }
+        if(name.size() < 4 || name.compare(name.size() - 4,4,".bin") != 0){continue;}
+        entries.push_back(std::make_pair((uint64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec,std::make_pair(path,(uint64_t)info.st_size)));
+        total += info.st_size;
+    }
+    closedir(dir);
+    // least recently used first
+    std::sort(entries.begin(),entries.end());
+    for(size_t i = 0; i < entries.size() && total > max_bytes; i++){
+        if(unlink(entries[i].second.first.c_str()) == 0){
+            total -= entries[i].second.second;
+        }
+    }
+    close(lock);
+}
@@ -0,0 +1,34 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <string>
+#include <set>
+#include <cstdint>
+#include "ddnnf.h"
+
+// On-disk cache of conditioned circuits, stored as binary nnf files named
+// after a hash of the input file and of the sorted condition literals.
+// Entries are written under a temporary name and renamed into place, and
+// hard linked to a private name before being read, so several processes
+// can share a directory while others add or evict entries. The least
+// recently used entries are removed once the directory exceeds max_bytes.
+class ResultCache{
+    private:
+    std::string directory;
+    uint64_t max_bytes;
+
+    std::string entry_name(const std::string& key)const;
+    std::string private_name(const std::string& prefix, const std::string& key)const;
+    void evict()const;
+
+    public:
+    // creates the directory if needed, exits if it cannot
+    ResultCache(const std::string& directory, uint64_t max_bytes);
+    // reads the whole input file, which therefore cannot be standard input
+    std::string key(const std::string& input_file, int input_format, const std::set<int>& conditions)const;
+    // false if there is no entry for key
+    bool load(const std::string& key, DDNNF& ddnnf)const;
+    void store(const std::string& key, const DDNNF& ddnnf)const;
+};
+
+#endif
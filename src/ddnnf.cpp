@@ -1,9 +1,34 @@
 #include "ddnnf.h"
-
-DDNNFNode::DDNNFNode(int id, DDNNF* manager, ddnnf_node_type type, int var) {
+#include "modular.h"
+#include "parallel.h"
+#include "varset.h"
+#include "stream.h"
+#include "binary.h"
+#include "stats.h"
+#include "error.h"
+#include <random>
+#include <climits>
+#include <unordered_map>
+
+// nodes mentioning fewer variables are handled by a single thread
+const int PARALLEL_POLY_THRESHOLD = 256;
+// batch queries are answered 64 * QUERY_LANE_WORDS at a time
+const int QUERY_LANE_WORDS = 4;
+// narrower levels are evaluated by the calling thread alone
+const int LEVEL_PARALLEL_THRESHOLD = 2048;
+// wide levels are split into about this many chunks per thread,
+// but never into chunks smaller than LEVEL_MIN_CHUNK nodes
+const int LEVEL_CHUNKS_PER_THREAD = 8;
+const int LEVEL_MIN_CHUNK = 256;
+// files are streamed in blocks of this many bytes
+const size_t READ_BLOCK_SIZE = 1 << 20;
+// files read in parallel are cut into this many pieces per thread
+const int LOAD_CHUNKS_PER_THREAD = 4;
+
+DDNNFNode::DDNNFNode(int id, ddnnf_node_type type, int var) {
     this->id = id;
-    this->manager = manager;
     this->type = type;
+    this->decision_var = 0;
     children = std::set<int>();
     parents = std::set<int>();
     if (type == DDNNF_LITERAL) {
@@ -34,6 +59,9 @@ void DDNNFNode::printNodeDetails()const{
     if(type == DDNNF_LITERAL){
         std::cout << "Node var: " << var << std::endl;
     }
+    if(type == DDNNF_OR && decision_var != 0){
+        std::cout << "Node decision var: " << decision_var << std::endl;
+    }
     std::cout << "Node children: ";
     for(auto child: children){
         std::cout << child << " ";
@@ -50,6 +78,10 @@ ddnnf_node_type DDNNFNode::get_type()const{return type;}
 
 int DDNNFNode::get_var()const{return var;}
 
+int DDNNFNode::get_decision_var()const{return decision_var;}
+void DDNNFNode::set_decision_var(int decision_var){this->decision_var = decision_var;}
+void DDNNFNode::set_var(int var){this->var = var;}
+
 int DDNNFNode::get_id()const{return id;}
 void DDNNFNode::set_id(int id){this->id = id;}
 
@@ -59,16 +91,13 @@ bool DDNNFNode::is_false()const{return type==DDNNF_FALSE;}
 
 void DDNNFNode::add_child(int child_id) {
     if(get_type() == DDNNF_LITERAL){
-        std::cerr << "Error: Cannot add children to literal node" << std::endl;
-        exit(1);
+        fail("Cannot add children to literal node");
     }
     if(get_type() == DDNNF_TRUE){
-        std::cerr << "Error: Cannot add children to true node" << std::endl;
-        exit(1);
+        fail("Cannot add children to true node");
     }
     if(get_type() == DDNNF_FALSE){
-        std::cerr << "Error: Cannot add children to false node" << std::endl;
-        exit(1);
+        fail("Cannot add children to false node");
     }
 
     children.insert(child_id);
@@ -78,25 +107,17 @@ void DDNNFNode::add_parent(int parent_id) {
     parents.insert(parent_id);
 }
 
-bool DDNNFNode::is_root()const{
-    return manager->is_root(this->id);
-}
-
 const std::set<int>& DDNNFNode::get_children()const{
     return children;
 }
 const std::set<int>& DDNNFNode::get_parents()const{
     return parents;
 }
-void DDNNFNode::change_parents_sign(){
-    std::set<int> new_parents = std::set<int>();
-    for(auto parent: parents){
-        new_parents.insert(-parent);
-    }
-    parents.clear();
-    for(auto parent: new_parents){
-        parents.insert(parent);
-    }
+void DDNNFNode::set_children(const std::set<int>& children){
+    this->children = children;
+}
+void DDNNFNode::set_parents(const std::set<int>& parents){
+    this->parents = parents;
 }
 void DDNNFNode::remove_child(int child_id){
     auto child_iter = std::find(children.begin(),children.end(),child_id);
@@ -110,27 +131,112 @@ void DDNNFNode::remove_parent(int parent_id){
     if(parent_iter != parents.end()){parents.erase(parent_id);}
 }
 
+DDNNFNodeStore::DDNNFNodeStore(){
+    data = std::make_shared<NodeVector>();
+}
+
+void DDNNFNodeStore::detach(){
+    // another store still uses the vector: take a private copy,
+    // nodes stay shared until they are modified
+    if(data.use_count() > 1){
+        data = std::make_shared<NodeVector>(*data);
+    }
+}
+
+size_t DDNNFNodeStore::size()const{
+    return data->size();
+}
+
+const DDNNFNode* DDNNFNodeStore::operator[](int id)const{
+    return (*data)[id].get();
+}
+
+DDNNFNode* DDNNFNodeStore::mut(int id){
+    detach();
+    std::shared_ptr<DDNNFNode>& node = (*data)[id];
+    if(node != nullptr && node.use_count() > 1){
+        node = std::make_shared<DDNNFNode>(*node);
+    }
+    return node.get();
+}
+
+void DDNNFNodeStore::push_back(DDNNFNode* node){
+    detach();
+    data->push_back(std::shared_ptr<DDNNFNode>(node));
+}
+
+void DDNNFNodeStore::remove(int id){
+    detach();
+    (*data)[id] = nullptr;
+}
+
+void DDNNFNodeStore::reorder(const std::vector<int>& order){
+    std::shared_ptr<NodeVector> new_data = std::make_shared<NodeVector>();
+    new_data->reserve(order.size());
+    for(int id: order){
+        new_data->push_back((*data)[id]);
+    }
+    data = new_data;
+}
+
+void DDNNFNodeStore::clear(){
+    // never clear a vector shared with another store
+    data = std::make_shared<NodeVector>();
+}
+
+DDNNFNodeStore::const_iterator DDNNFNodeStore::begin()const{
+    return const_iterator(data->begin());
+}
+
+DDNNFNodeStore::const_iterator DDNNFNodeStore::end()const{
+    return const_iterator(data->end());
+}
+
+DDNNFNodeStore::const_iterator::const_iterator(NodeVector::const_iterator iter){
+    this->iter = iter;
+}
+
+const DDNNFNode* DDNNFNodeStore::const_iterator::operator*()const{
+    return iter->get();
+}
+
+DDNNFNodeStore::const_iterator& DDNNFNodeStore::const_iterator::operator++(){
+    ++iter;
+    return *this;
+}
+
+bool DDNNFNodeStore::const_iterator::operator!=(const const_iterator& other)const{
+    return iter != other.iter;
+}
+
 DDNNF::DDNNF() {
-    nodes = std::vector<DDNNFNode*>();
-    literals = std::map<int, int>();
-    mentioned_vars = std::set<int>();
+    stats = nullptr;
+    simplify_on_load = true;
+    nodes = DDNNFNodeStore();
+    literals = SharedValue<std::map<int,int>>();
+    mentioned_vars = SharedValue<std::set<int>>();
+    original_variables = SharedValue<std::vector<int>>();
 
     reset();
 }
 
 DDNNF::~DDNNF() {
-    // delete all non-null nodes
-    for(auto node: nodes){
-        if(node != nullptr){
-            delete node;
-        }
-    }
+    // nodes are reference counted by the node store
 }
 
-bool DDNNF::is_root(int node_id) {
+DDNNF::DDNNF(const DDNNF& other) = default;
+DDNNF::DDNNF(DDNNF&& other) = default;
+DDNNF& DDNNF::operator=(const DDNNF& other) = default;
+DDNNF& DDNNF::operator=(DDNNF&& other) = default;
+
+bool DDNNF::is_root(int node_id)const{
     return node_id == root_id;
 }
 
+int DDNNF::get_root_id()const{
+    return root_id;
+}
+
 long DDNNF::node_count()const{
     return nodes.size();
 }
@@ -149,49 +255,56 @@ int DDNNF::add_node(ddnnf_node_type type, int var) {
     if (type == DDNNF_TRUE) {
         // check there is not a true node yet
         if (true_node_id != -1) {
-            std::cerr << "Error: Multiple true nodes" << std::endl;
-            exit(1);
+            fail("Multiple true nodes");
         }
         // update true node id
         true_node_id = id;
     } else if (type == DDNNF_FALSE) {
         // check there is not a false node yet
         if (false_node_id != -1) {
-            std::cerr << "Error: Multiple false nodes" << std::endl;
-            exit(1);
+            fail("Multiple false nodes");
         }
         // update false node id
         false_node_id = id;
     } else if(type == DDNNF_LITERAL){
         // check var index is valid
-        if (literals.find(var) == literals.end()) {
-            std::cerr << "Error: Invalid literal" << std::endl;
-            exit(1);
+        if (literals->find(var) == literals->end()) {
+            fail("Invalid literal");
         }
         // check there is not a literal for the same variable index
-        if (literals[var] != -1) {
-            std::cerr << "Error: Multiple literals for the same variable" << std::endl;
-            exit(1);
+        if (literals->at(var) != -1) {
+            fail("Multiple literals for the same variable");
         }
         // update literals map
-        literals[var] = id;
+        literals.mut()[var] = id;
     }
     // create actual node and add it to the nodes map
-    DDNNFNode* node = new DDNNFNode(id, this, type, var);
+    DDNNFNode* node = new DDNNFNode(id, type, var);
     nodes.push_back(node);
     return id;
 }
 
 void DDNNF::add_edge(int parent_id, int child_id) {
     if ((child_id < 0) || (child_id >= nodes.size()) || (parent_id < 0) || (parent_id >= nodes.size())) {
-        std::cerr << "ADD EDGE Error: Invalid node id" << std::endl;
-        exit(1);
+        fail("Invalid node id");
     }
-    nodes[parent_id]->add_child(child_id);
-    nodes[child_id]->add_parent(parent_id);
+    nodes.mut(parent_id)->add_child(child_id);
+    nodes.mut(child_id)->add_parent(parent_id);
+}
+
+void DDNNF::set_stats(DDNNFStats* stats){
+    this->stats = stats;
+}
+
+void DDNNF::set_simplify_on_load(bool simplify_on_load){
+    this->simplify_on_load = simplify_on_load;
+}
+
+int DDNNF::get_total_variables()const{
+    return total_variables;
 }
 
-DDNNFNode* DDNNF::get_node(int id) {
+const DDNNFNode* DDNNF::get_node(int id)const{
     if ((id < 0) || (id >= nodes.size())) {
         return nullptr;
     }
@@ -199,23 +312,18 @@ DDNNFNode* DDNNF::get_node(int id) {
 }
 
 int DDNNF::get_literal_id(int var) {
-    if (literals.find(var) == literals.end()) {
+    if (literals->find(var) == literals->end()) {
         return -1;
     }
-    return literals[var];
+    return literals->at(var);
 }
 
 void DDNNF::reset(){
-    // delete all non-null nodes
-    for(auto node: nodes){
-        if(node != nullptr){
-            delete node;
-        }
-    }
+    // nodes are freed once no other copy uses them
     nodes.clear();
-    literals.clear();
-    mentioned_vars.clear();
-    
+    literals.assign(std::map<int,int>());
+    mentioned_vars.assign(std::set<int>());
+    original_variables.assign(std::vector<int>());
     root_id = -1;
     true_node_id = -1;
     false_node_id = -1;
@@ -224,186 +332,268 @@ void DDNNF::reset(){
 
 void DDNNF::prepare_literals(int num_vars) {
     // associates to all variables a pointer to null
+    std::map<int,int>& literal_ids = literals.mut();
     for (int i = 1; i <= num_vars; i++) {
         // check if key i exists
-        if (literals.find(i) == literals.end()) {
-            literals[i] = -1;
+        if (literal_ids.find(i) == literal_ids.end()) {
+            literal_ids[i] = -1;
         }
-        if (literals.find(-i) == literals.end()) {
-            literals[-i] = -1;
+        if (literal_ids.find(-i) == literal_ids.end()) {
+            literal_ids[-i] = -1;
         }
     }
 }
 
 void print_c2d_error(){
-    std::cerr << "Error: File is not in c2d nnf format" << std::endl;
-    exit(1);
+    fail("File is not in c2d nnf format");
 }
 
 void print_d4_error(std::string error){
-    std::cerr << "Error: File is not in d4 nnf format" << std::endl;
-    std::cerr << error << std::endl;
-    exit(1);
+    fail("File is not in d4 nnf format\n" + error);
 }
 
 bool is_digit(char c){
     return (c >= '0') && (c <= '9');
 }
 
-void DDNNF::read_c2d_file(const char* filename){
-    read_file(filename,C2D_FILE);
+void DDNNF::read_c2d_file(const char* filename, int threads){
+    read_file(filename,C2D_FILE,threads);
+}
+
+void DDNNF::read_ddnnf_file(const char* filename, int threads){
+    read_file(filename,DDNNF_FILE,threads);
+}
+
+void DDNNF::read_d4_file(const char* filename, int threads){
+    read_file(filename,D4_FILE,threads);
 }
 
-void DDNNF::read_ddnnf_file(const char* filename){
-    read_file(filename,DDNNF_FILE);
+void DDNNF::read_c2d_stream(std::istream& in){
+    read_stream(in,C2D_FILE);
 }
 
-void DDNNF::read_d4_file(const char* filename){
+void DDNNF::read_ddnnf_stream(std::istream& in){
+    read_stream(in,DDNNF_FILE);
+}
+
+void DDNNF::read_d4_stream(std::istream& in){
+    read_stream(in,D4_FILE);
+}
+
+void DDNNF::read_file(const char* filename, file_format format, int threads) {
+    // standard input and compressed files can only be read front to back
+    if(threads <= 1 || is_standard_stream(filename) || detect_compression(filename) != NO_COMPRESSION){
+        InputFile infile(filename,false);
+        read_stream(infile.stream(),format);
+        return;
+    }
+    LoadState state;
+    begin_load(state,format);
+    load_mapped_file(filename,state,threads);
+    finish_load(state);
+}
+
+void DDNNF::read_stream(std::istream& in, file_format format){
+    LoadState state;
+    begin_load(state,format);
+    // parse block by block, the stream is never rewound
+    ParsedChunk chunk = ParsedChunk();
+    read_line_blocks(in,READ_BLOCK_SIZE,[&](const char* begin, const char* end){
+        chunk.clear();
+        parse_lines(begin,end,format,chunk);
+        load_chunk(chunk,state);
+    });
+    finish_load(state);
+}
+
+void DDNNF::begin_load(LoadState& state, file_format format){
     reset();
-    std::ifstream infile;
-
-    // check if file exists
-    infile.open(filename);
-    if (!infile) {
-        std::cerr << "Error: Unable to open file " << filename << std::endl;
-        exit(1);
-    }
-
-    std::string line;
-    std::string token;
-    bool found_nodes = false;
-    int max_literal = 0;
-    int max_defined_node = 0;
-    // bool defining_edges = false;
-
-    std::vector<std::pair<int,int>> edges_found = std::vector<std::pair<int,int>>();
-    std::vector<std::vector<int>> literals_for_edge = std::vector<std::vector<int>>();
-    std::vector<int> literals_found_in_file = std::vector<int>();
-    // add buffer 0-th AND node
-    // since D4 format starts at node index 1
-    add_node(DDNNF_AND,0);
-    while (std::getline(infile,line)){
-        std::istringstream iss(line);
-        // skip empty lines
-        if(!(iss >> token)){continue;}
-
-        // check if current line describes a node
-        char node_type = token[0];
-        switch (node_type)
-        {
-            case 'a':{
-                // if(defining_edges){print_d4_error("and node wile defining edges");}
-                found_nodes = true;
-                add_node(DDNNF_AND,0);
-                max_defined_node++;
-                continue;
-            }break;
-            case 'o':{
-                // if(defining_edges){print_d4_error("or node while definining edges");}
-                found_nodes = true;
-                add_node(DDNNF_OR,0);
-                max_defined_node++;
-                continue;
-            }break;
-            case 't':{
-                // if(defining_edges){print_d4_error("true node while defining edges");}
-                found_nodes = true;
-                add_node(DDNNF_TRUE,0);
-                max_defined_node++;
-                continue;
-            }break;
-            case 'f':{
-                // if(defining_edges){print_d4_error("false node while defining edges");}
-                found_nodes = true;
-                add_node(DDNNF_FALSE,0);
-                max_defined_node++;
-                continue;
-            }break;
-            default:{
-                // line is edge, should start with a number
-                if(!is_digit(node_type)){
-                    print_d4_error("node type is not digit");
+    state = LoadState();
+    state.format = format;
+    state.records = 0;
+    state.last_node_id = -1;
+    state.found_nodes = false;
+    state.max_literal = 0;
+    state.max_defined_node = 0;
+    state.edge_literal_starts = std::vector<size_t>(1,0);
+    if(format == D4_FILE){
+        // add buffer 0-th AND node
+        // since D4 format starts at node index 1
+        add_node(DDNNF_AND,0);
+    }
+}
+
+void DDNNF::parse_lines(const char* begin, const char* end, file_format format, ParsedChunk& chunk){
+    if(format == D4_FILE){
+        parse_d4_lines(begin,end,chunk);
+    }else{
+        parse_c2d_lines(begin,end,chunk);
+    }
+}
+
+void DDNNF::load_mapped_file(const char* filename, LoadState& state, int threads){
+    // map the file and cut it at newlines: the pieces are tokenized in
+    // parallel while this thread builds the nodes of the finished pieces
+    // in file order, so ids are assigned exactly as in a sequential read
+    MappedFile file(filename);
+    std::vector<std::pair<const char*,const char*>> pieces = split_lines(file.begin(),file.end(),threads * LOAD_CHUNKS_PER_THREAD);
+    int piece_count = pieces.size();
+    std::vector<ParsedChunk> chunks = std::vector<ParsedChunk>(piece_count);
+    std::vector<bool> parsed = std::vector<bool>(piece_count,false);
+    std::mutex parsed_lock;
+    std::condition_variable parsed_signal;
+    // errors of either side stop the other one, the tokenizer is
+    // always joined before they are rethrown
+    std::exception_ptr tokenizer_error;
+    std::exception_ptr build_error;
+    bool stopped = false;
+    std::thread tokenizer([&](){
+        try{
+            // pieces are handed out in order, so the next one to build is parsed first
+            parallel_for(piece_count,threads,[&](int piece){
+                {
+                    std::lock_guard<std::mutex> guard(parsed_lock);
+                    if(stopped){return;}
                 }
-                // defining_edges = true;
+                parse_lines(pieces[piece].first,pieces[piece].second,state.format,chunks[piece]);
+                std::lock_guard<std::mutex> guard(parsed_lock);
+                parsed[piece] = true;
+                parsed_signal.notify_all();
+            });
+        }catch(...){
+            std::lock_guard<std::mutex> guard(parsed_lock);
+            tokenizer_error = std::current_exception();
+            stopped = true;
+            parsed_signal.notify_all();
+        }
+    });
+    try{
+        for(int piece = 0; piece < piece_count; piece++){
+            {
+                std::unique_lock<std::mutex> guard(parsed_lock);
+                parsed_signal.wait(guard,[&](){return parsed[piece] || stopped;});
+                if(!parsed[piece]){break;}
             }
+            load_chunk(chunks[piece],state);
+            // release the tokens as soon as they are used
+            chunks[piece] = ParsedChunk();
         }
+    }catch(...){
+        build_error = std::current_exception();
+        std::lock_guard<std::mutex> guard(parsed_lock);
+        stopped = true;
+    }
+    tokenizer.join();
+    if(build_error){std::rethrow_exception(build_error);}
+    if(tokenizer_error){std::rethrow_exception(tokenizer_error);}
+}
 
-        // check if current line describes an edge
-        int source_id;
-        int destination_id;
-        try{
-            source_id = std::stoi(token);
-        }catch(std::invalid_argument& e){print_d4_error("source id is not integer");}
-        // check source bounds
-        // if(source_id < 1 || source_id > max_defined_node){print_d4_error("source index out of bounds");}
-        if(!(iss >> token)){print_d4_error("cannot find destination for source");}
-        try{
-            destination_id = std::stoi(token);
-        }catch(std::invalid_argument& e){print_d4_error("destination id is not integer");}
-        // check dst bounds
-        // if(destination_id < 1 || destination_id > max_defined_node){print_d4_error("destination index out of bounds");}
-        // check source and dst are distinct
-        if(source_id == destination_id){print_d4_error("source and dst are the same");}
-        // add edge
-        edges_found.push_back(std::make_pair(source_id,destination_id));
-
-        // read literals
-        std::vector<int> edge_literal_node_ids = std::vector<int>();
-        while(iss >> token){
-            int literal;
-            try{
-                literal = std::stoi(token);
-            }catch(std::invalid_argument& e){print_d4_error("literal is not integer");}
-            // if literal is 0, line ends
-            if(literal == 0){break;}
-            int abs_literal = abs(literal);
-            mentioned_vars.insert(abs_literal);
-            if(abs_literal > max_literal){
-                max_literal = abs_literal;
+void DDNNF::load_chunk(const ParsedChunk& chunk, LoadState& state){
+    for(size_t record = 0; record < chunk.size(); record++){
+        char kind = chunk.kind(record);
+        const int* values = chunk.record_values(record);
+        int value_count = chunk.value_count(record);
+        if(state.format == D4_FILE){
+            switch(kind){
+                case 'a': add_node(DDNNF_AND,0); break;
+                case 'o': add_node(DDNNF_OR,0); break;
+                case 't': add_node(DDNNF_TRUE,0); break;
+                case 'f': add_node(DDNNF_FALSE,0); break;
+                case 'e':{
+                    // bounds are checked once all nodes are known
+                    state.edges.push_back(std::make_pair(values[0],values[1]));
+                    for(int i = 2; i < value_count; i++){
+                        int abs_literal = abs(values[i]);
+                        mentioned_vars.mut().insert(abs_literal);
+                        if(abs_literal > state.max_literal){
+                            state.max_literal = abs_literal;
+                        }
+                        state.edge_literals.push_back(values[i]);
+                    }
+                    state.edge_literal_starts.push_back(state.edge_literals.size());
+                }break;
             }
-            
-            literals_found_in_file.push_back(literal);
-            edge_literal_node_ids.push_back(literal);
-        }
-
-        literals_for_edge.push_back(edge_literal_node_ids);
-
-        // // complete edge creation
-        // if(edge_literal_node_ids.size() == 0){
-        //     // add edge
-        //     add_edge(source_id,destination_id);
-        //     continue;
-        // }else{
-        //     // add edge with intermetiate AND node
-        //     int and_node_id = add_node(DDNNF_AND,0);
-        //     add_edge(source_id,and_node_id);
-        //     add_edge(and_node_id,destination_id);
-        //     // add edges from and node to literals
-        //     for(int literal_node_id: edge_literal_node_ids){
-        //         add_edge(and_node_id,literal_node_id);
-        //     }
-        // }
-    }
-    total_variables = max_literal;
-    // close stream
-    infile.close();
+            if(kind != 'e'){
+                state.found_nodes = true;
+                state.max_defined_node++;
+            }
+            state.records++;
+            continue;
+        }
+        // first line should be "nnf <num_nodes> <num_edges> <num_vars>"
+        if((kind == 'n') != (state.records == 0)){print_c2d_error();}
+        switch(kind){
+            case 'n':{
+                this->prepare_literals(values[0]);
+                total_variables = values[0];
+            } break;
+            case 'L':{
+                this->mentioned_vars.mut().insert(abs(values[0]));
+                state.last_node_id = this->add_node(DDNNF_LITERAL, values[0]);
+            } break;
+            case 'A':
+            case 'O':{
+                // OR lines carry the decision variable j before the children
+                int offset = kind == 'O' ? 1 : 0;
+                int count = values[offset];
+                if(count == 0){
+                    // TRUE or FALSE node
+                    state.last_node_id = this->add_node(kind == 'A' ? DDNNF_TRUE : DDNNF_FALSE, 0);
+                    break;
+                }
+                if(kind == 'O' && state.format == C2D_FILE && count != 2){print_c2d_error();}
+                int node_id = this->add_node(kind == 'A' ? DDNNF_AND : DDNNF_OR, 0);
+                if(kind == 'O'){
+                    nodes.mut(node_id)->set_decision_var(abs(values[0]));
+                }
+                for(int i = offset + 1; i < value_count; i++){
+                    // children always come before their parents
+                    int child_id = values[i];
+                    if(child_id < 0 || child_id >= node_id){print_c2d_error();}
+                    nodes.mut(node_id)->add_child(child_id);
+                    nodes.mut(child_id)->add_parent(node_id);
+                }
+                state.last_node_id = node_id;
+            } break;
+        }
+        state.records++;
+    }
+    // malformed lines are reported after the lines preceding them are loaded
+    if(chunk.failed){
+        if(state.format == D4_FILE){
+            print_d4_error(chunk.error);
+        }
+        print_c2d_error();
+    }
+}
+
+void DDNNF::finish_load(LoadState& state){
+    if(state.format != D4_FILE){
+        if (state.last_node_id == -1) {
+            fail("No nodes found");
+        }
+        this->root_id = state.last_node_id;
+        if(simplify_on_load){simplify();}
+        return;
+    }
 
+    total_variables = state.max_literal;
     prepare_literals(total_variables);
-    for(auto literal: literals_found_in_file){
-        if(literals[literal] == -1){
+    for(auto literal: state.edge_literals){
+        if(literals->at(literal) == -1){
             // create node for literal if not present
             add_node(DDNNF_LITERAL,literal);
         }
     }
 
-    for(int i = 0; i< edges_found.size();i++){
-        auto edge = edges_found[i];
+    int max_defined_node = state.max_defined_node;
+    for(size_t i = 0; i < state.edges.size(); i++){
+        auto edge = state.edges[i];
         int source_id = edge.first;
         int destination_id = edge.second;
         if(source_id < 1 || source_id > max_defined_node){print_d4_error("source index out of bounds");}
         if(destination_id < 1 || destination_id > max_defined_node){print_d4_error("destination index out of bounds");}
-        auto literals_for_node = literals_for_edge[i];
-        if(literals.empty()){
+        if(literals->empty()){
             // add edge
             add_edge(source_id,destination_id);
         }else{
@@ -411,16 +601,19 @@ void DDNNF::read_d4_file(const char* filename){
             add_edge(source_id,and_node_id);
             add_edge(and_node_id,destination_id);
             // add edges from and node to literals
-            for(int literal_node_id: literals_for_node){
-                add_edge(and_node_id,literals[literal_node_id]);
+            for(size_t j = state.edge_literal_starts[i]; j < state.edge_literal_starts[i + 1]; j++){
+                add_edge(and_node_id,literals->at(state.edge_literals[j]));
             }
         }
     }
+    // the edges are no longer needed
+    std::vector<std::pair<int,int>>().swap(state.edges);
+    std::vector<int>().swap(state.edge_literals);
+    std::vector<size_t>().swap(state.edge_literal_starts);
 
     // check that at least one node was found
-    if(!found_nodes){
-        std::cerr << "Error: No nodes defined" << std::endl;
-        exit(1);
+    if(!state.found_nodes){
+        fail("No nodes defined");
     }
 
     // find root node
@@ -431,145 +624,82 @@ void DDNNF::read_d4_file(const char* filename){
         }
     }
     if(root_id == -1){
-        std::cerr << "Error: No root node found" << std::endl;
-        exit(1);
+        fail("No root node found");
     }
 
     // complete reading by simplifying the formula
-    simplify();
-
+    if(simplify_on_load){simplify();}
 }
 
-void DDNNF::read_file(const char* filename, file_format format) {
-    if(format == D4_FILE){
-        std::cerr << "Error: D4 format not supported on this function" << std::endl;
-        exit(1);
-    }
+void DDNNF::read_binary_file(const char* filename){
     reset();
-    
-    // init stream
-    std::ifstream(infile);
-
-    // check if file exists
-    infile.open(filename);
-    if (!infile) {
-        std::cerr << "Error: Unable to open file " << filename << std::endl;
-        exit(1);
-    }
-
-    // read line by line
-    std::string line;
-    bool is_first_line = true;
-    // last node parsed is always the root node
-    int last_node_id = -1;
-    while (std::getline(infile, line)) {
-        std::istringstream iss(line);
-        std::string token;
-        // skip empty lines
-        if(!(iss >> token)){continue;}
-        if(is_first_line){
-            // first line should be "nnf <num_nodes> <num_edges> <num_vars>"
-            if(token != "nnf") {print_c2d_error();}
-            // check if there are 3 more tokens
-            for(int i = 0; i < 3; i++){
-                if(!(iss >> token)){print_c2d_error();}
-                // last token should have the number of variables
-                if (i == 2) {
-                    try{
-                        int token_value = std::stoi(token);
-                        this->prepare_literals(token_value);
-                        total_variables = token_value;
-                    }catch(std::invalid_argument& e){print_c2d_error();}
-                }
-            }
-            is_first_line = false;
-        }else{
-            // node lines should be "<node_type> node_data..."
-            if(token.length() != 1){print_c2d_error();}
-            char node_type = token[0];
-            switch(node_type){
-                case 'L':{
-                    if(!(iss >> token)){print_c2d_error();}
-                    try{
-                        int var = std::stoi(token);
-                        this->mentioned_vars.insert(abs(var));
-                        last_node_id = this->add_node(DDNNF_LITERAL, var);
-                    }catch(std::invalid_argument& e){print_c2d_error();}
-                } break;
-                case 'A':{
-                    if(!(iss >> token)){print_c2d_error();}
-                    try{
-                        int count = std::stoi(token);
-                        if(count == 0){
-                            // TRUE node
-                            last_node_id = this->add_node(DDNNF_TRUE, 0);
-                        }else{
-                            // AND node
-                            int node_id = this->add_node(DDNNF_AND, 0);
-                            while(count > 0){
-                                if(!(iss >> token)){print_c2d_error();}
-                                try{
-                                    int child_id = std::stoi(token);
-                                    this->get_node(node_id)->add_child(child_id);
-                                    this->get_node(child_id)->add_parent(node_id);
-                                    count--;
-                                }catch(std::invalid_argument& e){print_c2d_error();}
-                            }
-                            last_node_id = node_id;
-                        }
-                    }catch(std::invalid_argument& e){print_c2d_error();}
-                } break;
-                case 'O':{
-                    //read j (and ignore it)
-                    if(!(iss >> token)){print_c2d_error();}
-                    if(!(iss >> token)){print_c2d_error();}
-                    try{
-                        int count = std::stoi(token);
-                        if(count == 0){
-                            // FALSE node
-                            last_node_id = this->add_node(DDNNF_FALSE, 0);
-                        }else if(format == C2D_FILE){
-                            // OR node
-                            if(count != 2){print_c2d_error();}
-                        }
-                        int node_id = this->add_node(DDNNF_OR, 0);
-                        while(count > 0){
-                            if(!(iss >> token)){print_c2d_error();}
-                            try{
-                                int child_id = std::stoi(token);
-                                this->get_node(node_id)->add_child(child_id);
-                                this->get_node(child_id)->add_parent(node_id);
-                                count--;
-                            }catch(std::invalid_argument& e){print_c2d_error();}
-                        }
-                        last_node_id = node_id;
-                    }catch(std::invalid_argument& e){print_c2d_error();}
-                } break;
-                default: print_c2d_error();
-            }
+    BinaryNodeFile file(filename);
+    if(file.node_count() > (uint64_t)INT_MAX){
+        fail("Circuit is too large to be loaded, use -ooc");
+    }
+    total_variables = file.total_variables();
+    prepare_literals(total_variables);
+    for(uint64_t id = 0; id < file.node_count(); id++){
+        file.check_node(id);
+        ddnnf_node_type type = file.type(id);
+        int node_id = add_node(type,type == DDNNF_LITERAL ? file.var(id) : 0);
+        if(type == DDNNF_LITERAL){
+            mentioned_vars.mut().insert(abs(file.var(id)));
+        }
+        if(type == DDNNF_OR){
+            nodes.mut(node_id)->set_decision_var(abs(file.var(id)));
+        }
+        const uint32_t* children = file.children(id);
+        for(uint64_t i = 0; i < file.child_count(id); i++){
+            nodes.mut(node_id)->add_child(children[i]);
+            nodes.mut(children[i])->add_parent(node_id);
         }
     }
-    infile.close();
+    root_id = file.root();
+    if(simplify_on_load){simplify();}
+}
 
-    if (last_node_id == -1) {
-        std::cerr << "Error: No nodes found" << std::endl;
-        exit(1);
-    }
-    this->root_id = last_node_id;
+// files ending in .gz or .zst are compressed
+void DDNNF::serialize(const char * filename)const{
+    OutputFile out(filename,compression_from_extension(filename),false);
+    serialize(out.stream());
+    out.close();
+}
 
-    simplify();
+void DDNNF::serialize_c2d(const char * filename)const{
+    OutputFile out(filename,compression_from_extension(filename),false);
+    serialize_c2d(out.stream());
+    out.close();
 }
 
-void DDNNF::serialize(const char * filename)const{
+void DDNNF::serialize_d4(const char * filename)const{
+    OutputFile out(filename,compression_from_extension(filename),false);
+    serialize_d4(out.stream());
+    out.close();
+}
+
+void DDNNF::serialize_binary(const char* filename)const{
+    // nodes are stored children first, as the binary format requires
+    BinaryNodeWriter writer(filename);
+    std::vector<uint32_t> children = std::vector<uint32_t>();
+    for(const DDNNFNode* node: nodes){
+        children.assign(node->get_children().begin(),node->get_children().end());
+        int var = 0;
+        if(node->is_literal()){var = node->get_var();}
+        if(node->get_type() == DDNNF_OR){var = node->get_decision_var();}
+        writer.add_node(node->get_type(),var,children.data(),children.size());
+    }
+    writer.finish(total_variables,root_id);
+}
+
+void DDNNF::serialize(std::ostream& out)const{
     // uses c2d format, extending OR nodes to allow for more than 2 children
     int total_nodes = node_count();
     int total_vars = this->total_variables;
     int total_edges = edge_count();
-    
 
-    std::ofstream out(filename);
     out<<"nnf "<<total_nodes<<" "<<total_edges<<" "<<total_vars<<"\n";
-    for(DDNNFNode* node: nodes){
+    for(const DDNNFNode* node: nodes){
         ddnnf_node_type node_type = node->get_type();
         switch(node_type){
             case DDNNF_AND:{
@@ -582,8 +712,8 @@ void DDNNF::serialize(const char * filename)const{
             } break;
             case DDNNF_OR:{
                 const std::set<int>& child_ids = node->get_children();
-                // always print j=0 since I dont store this information
-                out<<"O 0 "<<child_ids.size()<<" ";
+                // j is 0 unless the node is a known decision node
+                out<<"O "<<node->get_decision_var()<<" "<<child_ids.size()<<" ";
                 for(int child: child_ids){
                     out<<child<<" ";
                 }
@@ -601,7 +731,6 @@ void DDNNF::serialize(const char * filename)const{
             default: print_c2d_error();
         }
     }
-    out.close();
 }
 
 // long DDNNF::model_count(const std::set<int>& vars)const{
@@ -765,28 +894,228 @@ void DDNNF::serialize(const char * filename)const{
 //     }
 // }
 
-void DDNNF::condition_all(const std::set<int>& vars){
+void DDNNF::condition_all(const std::set<int>& vars, int threads){
     // check input
     for(int var: vars){
         if(vars.find(-var) != vars.end()){
-            std::cerr << "Error: Cannot condition on both a variable and its negation" << std::endl;
-            exit(1);
+            fail("Cannot condition on both a variable and its negation");
         }
     }
+    if(threads > 1 && condition_components(vars,threads)){
+        return;
+    }
     // condition on all vars one at a time
     for(int var: vars){
-        condition(var);
+        if(stats == nullptr){
+            condition(var);
+            continue;
+        }
+        ConditionStep step = ConditionStep();
+        step.literal = var;
+        step.nodes_before = node_count();
+        step.edges_before = edge_count();
+        step.milliseconds = 0;
+        {
+            PhaseTimer timer(&step.milliseconds);
+            condition(var);
+        }
+        step.nodes_after = node_count();
+        step.edges_after = edge_count();
+        stats->condition_steps.push_back(step);
+    }
+}
+
+bool DDNNF::condition_components(const std::set<int>& vars, int threads){
+    // children of a decomposable AND share no variables, so after
+    // simplification they share no nodes either: each literal only
+    // touches the component mentioning its variable
+    if(root_id < 0 || nodes[root_id]->get_type() != DDNNF_AND){return false;}
+    std::vector<int> roots = std::vector<int>(nodes[root_id]->get_children().begin(),nodes[root_id]->get_children().end());
+    std::vector<int> component = std::vector<int>(nodes.size(),-1);
+    std::vector<int> var_component = std::vector<int>(total_variables + 1,-1);
+    for(int c = 0; c < (int)roots.size(); c++){
+        std::vector<int> stack = std::vector<int>(1,roots[c]);
+        while(!stack.empty()){
+            int node_id = stack.back();
+            stack.pop_back();
+            if(component[node_id] == c){continue;}
+            // a node shared by two components: not decomposable, condition sequentially
+            if(component[node_id] != -1){return false;}
+            component[node_id] = c;
+            const DDNNFNode* node = nodes[node_id];
+            if(node->is_literal()){var_component[abs(node->get_var())] = c;}
+            for(int child: node->get_children()){stack.push_back(child);}
+        }
+    }
+    std::vector<std::set<int>> parts = std::vector<std::set<int>>(roots.size());
+    std::vector<int> free_literals = std::vector<int>();
+    for(int var: vars){
+        // same checks as condition
+        if(var == 0){
+            fail("Cannot condition on 0");
+        }
+        if(literals->find(var) == literals->end()){
+            fail("Invalid literal to condition");
+        }
+        int c = var_component[abs(var)];
+        if(c == -1){
+            free_literals.push_back(var);
+        }else{
+            parts[c].insert(var);
+        }
+    }
+    std::vector<int> touched = std::vector<int>();
+    for(int c = 0; c < (int)roots.size(); c++){
+        if(!parts[c].empty()){touched.push_back(c);}
+    }
+    if(touched.size() < 2){return false;}
+
+    // condition every touched component on its own copy, each with its
+    // own stats so that the threads never share counters
+    std::vector<DDNNF> results = std::vector<DDNNF>(roots.size());
+    std::vector<DDNNFStats> parts_stats = std::vector<DDNNFStats>(stats == nullptr ? 0 : roots.size());
+    parallel_for(touched.size(),threads,[&](int index){
+        int c = touched[index];
+        DDNNF& result = results[c];
+        result.total_variables = total_variables;
+        result.prepare_literals(total_variables);
+        result.root_id = result.copy_sub_dag(*this,roots[c],0);
+        result.simplify();
+        if(stats != nullptr){result.set_stats(&parts_stats[c]);}
+        result.condition_all(parts[c],1);
+    });
+    // steps are added component by component, with the sizes of the component
+    if(stats != nullptr){
+        for(int c: touched){stats->add(parts_stats[c]);}
+    }
+
+    // stitch the components back under a new root AND, with the
+    // literals no component mentions, as condition would add them
+    DDNNF stitched = DDNNF();
+    stitched.total_variables = total_variables;
+    stitched.original_variables = original_variables;
+    stitched.prepare_literals(total_variables);
+    std::vector<int> parts_roots = std::vector<int>();
+    for(int c = 0; c < (int)roots.size(); c++){
+        if(parts[c].empty()){
+            parts_roots.push_back(stitched.copy_sub_dag(*this,roots[c],0));
+        }else{
+            parts_roots.push_back(stitched.copy_sub_dag(results[c],results[c].root_id,0));
+        }
+        // components are freed as soon as they are copied
+        results[c] = DDNNF();
+    }
+    for(int var: free_literals){
+        parts_roots.push_back(stitched.add_node(DDNNF_LITERAL,var));
+    }
+    stitched.root_id = stitched.add_node(DDNNF_AND,0);
+    for(int child: parts_roots){
+        stitched.add_edge(stitched.root_id,child);
+    }
+    stitched.set_stats(stats);
+    stitched.simplify();
+    *this = std::move(stitched);
+    return true;
+}
+
+int DDNNF::copy_sub_dag(const DDNNF& source, int source_root, int offset){
+    std::vector<int> reachable = std::vector<int>();
+    if(source_root == source.root_id){
+        // every node of a simplified circuit is reachable from the root
+        for(int node_id = 0; node_id < (int)source.nodes.size(); node_id++){
+            reachable.push_back(node_id);
+        }
+    }else{
+        std::set<int> seen = std::set<int>();
+        std::vector<int> stack = std::vector<int>(1,source_root);
+        while(!stack.empty()){
+            int node_id = stack.back();
+            stack.pop_back();
+            if(!seen.insert(node_id).second){continue;}
+            reachable.push_back(node_id);
+            for(int child: source.nodes[node_id]->get_children()){stack.push_back(child);}
+        }
+    }
+    // ids are children first in a simplified circuit
+    std::sort(reachable.begin(),reachable.end());
+    std::unordered_map<int,int> copies = std::unordered_map<int,int>();
+    copies.reserve(reachable.size());
+    for(int node_id: reachable){
+        const DDNNFNode* node = source.nodes[node_id];
+        int copy;
+        if(node->get_type() == DDNNF_TRUE && true_node_id != -1){
+            copy = true_node_id;
+        }else if(node->get_type() == DDNNF_FALSE && false_node_id != -1){
+            copy = false_node_id;
+        }else if(node->is_literal()){
+            int var = node->get_var();
+            copy = add_node(DDNNF_LITERAL,var > 0 ? var + offset : var - offset);
+        }else{
+            copy = add_node(node->get_type(),0);
+        }
+        if(node->get_type() == DDNNF_OR && node->get_decision_var() != 0){
+            nodes.mut(copy)->set_decision_var(node->get_decision_var() + offset);
+        }
+        for(int child: node->get_children()){
+            add_edge(copy,copies[child]);
+        }
+        copies[node_id] = copy;
+    }
+    return copies[source_root];
+}
+
+void DDNNF::conjoin(std::vector<DDNNF>& others, bool offset_variables){
+    // every circuit is copied once, so the conjunction is linear in the inputs
+    std::vector<int> offsets = std::vector<int>(1,0);
+    long result_variables = total_variables;
+    for(const DDNNF& other: others){
+        offsets.push_back(offset_variables ? (int)result_variables : 0);
+        result_variables = offset_variables ? result_variables + other.total_variables : std::max(result_variables,(long)other.total_variables);
+    }
+    if(result_variables > INT_MAX / 2){
+        fail("Too many variables in the conjunction");
+    }
+    if(!offset_variables){
+        // a variable mentioned twice would break decomposability
+        VarSet seen = VarSet();
+        for(int var: *mentioned_vars){seen.insert(var);}
+        for(const DDNNF& other: others){
+            VarSet vars = VarSet();
+            for(int var: *other.mentioned_vars){vars.insert(var);}
+            if(seen.intersects(vars)){
+                for(int var: *other.mentioned_vars){
+                    if(seen.contains(var)){
+                        fail("Circuits to conjoin share variable " + std::to_string(var));
+                    }
+                }
+            }
+            seen.unite(vars);
+        }
+    }
+    DDNNF result = DDNNF();
+    result.total_variables = result_variables;
+    result.prepare_literals(result.total_variables);
+    std::vector<int> roots = std::vector<int>(1,result.copy_sub_dag(*this,root_id,0));
+    for(size_t i = 0; i < others.size(); i++){
+        roots.push_back(result.copy_sub_dag(others[i],others[i].root_id,offsets[i + 1]));
+        // inputs are freed as soon as they are copied
+        others[i] = DDNNF();
+    }
+    result.root_id = result.add_node(DDNNF_AND,0);
+    for(int root: roots){
+        result.add_edge(result.root_id,root);
     }
+    result.stats = stats;
+    result.simplify();
+    *this = std::move(result);
 }
 
 void DDNNF::condition(int var){
     if(var == 0){
-        std::cerr << "Error: Cannot condition on 0" << std::endl;
-        exit(1);
+        fail("Cannot condition on 0");
     }
-    if(literals.find(var) == literals.end()){
-        std::cerr << "Error: Invalid literal to condition" << std::endl;
-        exit(1);
+    if(literals->find(var) == literals->end()){
+        fail("Invalid literal to condition");
     }
     if(true_node_id == -1){
         add_node(DDNNF_TRUE,0);
@@ -794,26 +1123,33 @@ void DDNNF::condition(int var){
     if(false_node_id == -1){
         add_node(DDNNF_FALSE,0);
     }
-    for(auto node: nodes){
-        if(! node->is_literal()){continue;}
+    // drop the branches of decision nodes on var that contradict var,
+    // so that their sub-DAGs are removed without being simplified
+    prune_decisions(var);
+    // iterate by index: removing nodes while iterating the store is not safe
+    for(int node_id = 0; node_id < (int)nodes.size(); node_id++){
+        const DDNNFNode* node = nodes[node_id];
+        if(node == nullptr || ! node->is_literal()){continue;}
         if(node->get_var() == var){
-            literals[var] = -1;
+            literals.mut()[var] = -1;
             for(auto parent: node->get_parents()){
-                nodes[parent]->remove_child(node->get_id());
+                nodes.mut(parent)->remove_child(node_id);
                 add_edge(parent,true_node_id);
             }
-            DDNNFNode* old_node = nodes[node->get_id()];
-            nodes[old_node->get_id()] = nullptr;
-            delete old_node;
+            // a circuit that is just the literal
+            if(root_id == node_id){root_id = true_node_id;}
+            nodes.remove(node_id);
+            if(stats != nullptr){stats->constants_propagated++;}
         }else if(node->get_var() == -var){
-            literals[-var] = -1;
+            literals.mut()[-var] = -1;
             for(auto parent: node->get_parents()){
-                nodes[parent]->remove_child(node->get_id());
+                nodes.mut(parent)->remove_child(node_id);
                 add_edge(parent,false_node_id);
             }
-            DDNNFNode* old_node = nodes[node->get_id()];
-            nodes[old_node->get_id()] = nullptr;
-            delete old_node;
+            // a circuit that is just the literal
+            if(root_id == node_id){root_id = false_node_id;}
+            nodes.remove(node_id);
+            if(stats != nullptr){stats->constants_propagated++;}
         }
     }
     // create new node for literal var
@@ -828,6 +1164,38 @@ void DDNNF::condition(int var){
     simplify();
 }
 
+void DDNNF::prune_decisions(int var){
+    int negated_literal_id = literals->at(-var);
+    if(negated_literal_id == -1){return;}
+    // the branches of a decision node on var are either the literal -var
+    // or AND nodes having -var as a child: both are false once var holds
+    std::vector<std::pair<int,int>> edges_to_remove = std::vector<std::pair<int,int>>();
+    for(auto parent: nodes[negated_literal_id]->get_parents()){
+        if(nodes[parent]->get_type() == DDNNF_OR){
+            if(nodes[parent]->get_decision_var() == abs(var)){
+                edges_to_remove.push_back(std::make_pair(parent,negated_literal_id));
+            }
+        }else if(nodes[parent]->get_type() == DDNNF_AND){
+            for(auto grandparent: nodes[parent]->get_parents()){
+                if(nodes[grandparent]->get_type() == DDNNF_OR && nodes[grandparent]->get_decision_var() == abs(var)){
+                    edges_to_remove.push_back(std::make_pair(grandparent,parent));
+                }
+            }
+        }
+    }
+    for(auto edge: edges_to_remove){
+        int decision_id = edge.first;
+        int branch_id = edge.second;
+        // keep at least one child, otherwise the node would become an
+        // empty OR: the remaining branch simplifies to false anyway
+        if(nodes[decision_id]->get_children().size() <= 1){continue;}
+        nodes.mut(decision_id)->remove_child(branch_id);
+        nodes.mut(branch_id)->remove_parent(decision_id);
+        // a decision with a single branch left is no longer a decision
+        nodes.mut(decision_id)->set_decision_var(0);
+    }
+}
+
 void DDNNF::simplify(){
     // temporarely add a true and false node if they are not present yet
     if(true_node_id == -1){
@@ -837,107 +1205,288 @@ void DDNNF::simplify(){
         add_node(DDNNF_FALSE,0);
     }
 
+    if(stats != nullptr){stats->simplify_calls++;}
+
     // simplify boolean constants in the DDNNF
     std::vector<bool> visited = std::vector<bool>(nodes.size(),false);
-    simplify_truth_rec(root_id,visited);
+    {
+        PhaseTimer timer(stats == nullptr ? nullptr : &stats->simplify_truth_ms);
+        simplify_truth_rec(root_id,visited);
+    }
 
     // remove all nodes that 
     // don't have parents
     // and are not root
-    remove_unreferenced_nodes();
+    {
+        PhaseTimer timer(stats == nullptr ? nullptr : &stats->remove_unreferenced_ms);
+        remove_unreferenced_nodes();
+    }
 
     // indexes of nodes have to change
     // to delete all gaps from removed
     // nodes
-    recompute_indexes();
+    {
+        PhaseTimer timer(stats == nullptr ? nullptr : &stats->recompute_indexes_ms);
+        recompute_indexes();
+    }
 
     // some vars may disappear after simplification
+    PhaseTimer timer(stats == nullptr ? nullptr : &stats->recompute_mentioned_vars_ms);
     recompute_mentioned_vars();
 }
 
 void DDNNF::recompute_mentioned_vars(){
-    mentioned_vars = std::set<int>();
+    std::set<int> vars = std::set<int>();
     for(auto node: nodes){
         if(node->get_type() == DDNNF_LITERAL){
-            mentioned_vars.insert(abs(node->get_var()));
+            vars.insert(abs(node->get_var()));
         }
     }
+    mentioned_vars.assign(vars);
 }
 
 void DDNNF::recompute_indexes(){
+    // new indexes follow the DFS post-order from the root,
+    // so children always come before their parents
     std::vector<bool> visited = std::vector<bool>(nodes.size(),false);
-    std::vector<DDNNFNode*> new_nodes_vector = std::vector<DDNNFNode*>(); 
-    std::map<int,int> old_to_new_indexes = std::map<int,int>();
-    recompute_indexes_rec(root_id,visited,new_nodes_vector,old_to_new_indexes);
-    // parents are all negative indexes after the recursive function call
-    for(auto node: nodes){
-        if(node != nullptr){
-            node->change_parents_sign();
+    std::vector<int> new_order = std::vector<int>();
+    recompute_indexes_rec(root_id,visited,new_order);
+    apply_order(new_order,std::vector<int>());
+}
+
+void DDNNF::apply_order(const std::vector<int>& new_order, const std::vector<int>& var_map){
+    // new_order lists the old ids of the nodes to keep, children first,
+    // var_map[v] is the new name of variable v (empty to keep the names)
+    std::vector<int> old_to_new_indexes = std::vector<int>(nodes.size(),-1);
+    for(int new_index = 0; new_index < (int)new_order.size(); new_index++){
+        old_to_new_indexes[new_order[new_index]] = new_index;
+    }
+    bool rename = !var_map.empty();
+    if(rename){
+        // rebuilt from the renamed literal nodes below
+        literals.assign(std::map<int,int>());
+    }
+    std::map<int,int>& literal_ids = literals.mut();
+
+    for(int new_index = 0; new_index < (int)new_order.size(); new_index++){
+        int old_index = new_order[new_index];
+        const DDNNFNode* node = nodes[old_index];
+
+        // update literal map, false_node_id and true_node_id
+        // if the current node is literal, true or false respectively
+        int new_var = node->get_var();
+        int new_decision_var = node->get_decision_var();
+        if(rename){
+            new_var = new_var < 0 ? -var_map[-new_var] : var_map[new_var];
+            new_decision_var = new_decision_var < (int)var_map.size() ? var_map[new_decision_var] : 0;
+        }
+        if(node->is_literal()){
+            literal_ids[new_var] = new_index;
+        }
+        if(node->is_true()){
+            true_node_id = new_index;
+        }
+        if(node->is_false()){
+            false_node_id = new_index;
+        }
+
+        // only touch nodes whose indexes change:
+        // nodes shared with a clone are copied when modified
+        bool changed = old_index != new_index || new_var != node->get_var() || new_decision_var != node->get_decision_var();
+        std::set<int> new_children = std::set<int>();
+        for(auto child: node->get_children()){
+            new_children.insert(old_to_new_indexes[child]);
+            changed = changed || old_to_new_indexes[child] != child;
+        }
+        std::set<int> new_parents = std::set<int>();
+        for(auto parent: node->get_parents()){
+            // drop parents that are no longer reachable from the root
+            if(old_to_new_indexes[parent] == -1){
+                changed = true;
+                continue;
+            }
+            new_parents.insert(old_to_new_indexes[parent]);
+            changed = changed || old_to_new_indexes[parent] != parent;
+        }
+        if(changed){
+            DDNNFNode* mutable_node = nodes.mut(old_index);
+            mutable_node->set_id(new_index);
+            mutable_node->set_children(new_children);
+            mutable_node->set_parents(new_parents);
+            mutable_node->set_var(new_var);
+            mutable_node->set_decision_var(new_decision_var);
         }
     }
-    nodes.clear();
-    for(DDNNFNode* node: new_nodes_vector){
-        nodes.push_back(node);
+    if(rename){
+        prepare_literals(*std::max_element(var_map.begin(),var_map.end()));
     }
-    // root is always last node visited in DFS
+    nodes.reorder(new_order);
+    // the root is the only node without parents, so it always comes last
     root_id = nodes.size() - 1;
 }
 
-void DDNNF::recompute_indexes_rec(int node_id, std::vector<bool>& visited, std::vector<DDNNFNode*>& new_nodes_vector, std::map<int,int>& old_to_new_indexes){
+void DDNNF::recompute_indexes_rec(int node_id, std::vector<bool>& visited, std::vector<int>& new_order)const{
     // skip visited nodes
     if(visited[node_id]){return;}
     // mark current node as visited
     visited[node_id] = true;
     // get children of current node
-    std::set<int> children = nodes[node_id]->get_children();
-    for(auto child: children){
+    for(auto child: nodes[node_id]->get_children()){
         // recompute indexes of children
-        recompute_indexes_rec(child,visited,new_nodes_vector, old_to_new_indexes);
+        recompute_indexes_rec(child,visited,new_order);
     }
-    // recompute node indes
-    int old_index = node_id;
-    new_nodes_vector.push_back(nodes[node_id]);
-    int new_index = new_nodes_vector.size() - 1;
-
-    // update node id
-    nodes[node_id]->set_id(new_index);
+    // node gets the next free index
+    new_order.push_back(node_id);
+}
 
-    // update literal map, false_node_id and true_node_id 
-    // if the current node is literal, true or false respectively
-    if(nodes[node_id]->is_literal()){
-        literals[nodes[node_id]->get_var()] = new_index;
+void DDNNF::compact_variables(){
+    // mentioned_vars is sorted, so the variables keep their relative order;
+    // decisions on variables that no longer appear become plain ORs
+    int max_var = mentioned_vars->empty() ? 0 : *mentioned_vars->rbegin();
+    std::vector<int> var_map = std::vector<int>(std::max(max_var,total_variables) + 1,0);
+    std::vector<int> originals = std::vector<int>(1,0);
+    for(int var: *mentioned_vars){
+        var_map[var] = originals.size();
+        originals.push_back(original_variables->empty() ? var : original_variables->at(var));
     }
-    if(nodes[node_id]->is_true()){
-        true_node_id = new_index;
+    // renamed while the nodes get their new ids
+    std::vector<bool> visited = std::vector<bool>(nodes.size(),false);
+    std::vector<int> new_order = std::vector<int>();
+    recompute_indexes_rec(root_id,visited,new_order);
+    apply_order(new_order,var_map);
+    original_variables.assign(originals);
+    total_variables = originals.size() - 1;
+    recompute_mentioned_vars();
+}
+
+int DDNNF::original_literal(int literal)const{
+    if(original_variables->empty()){return literal;}
+    return literal < 0 ? -original_variables->at(-literal) : original_variables->at(literal);
+}
+
+node_order node_order_from_name(const std::string& name){
+    if(name == "dfs"){return DFS_ORDER;}
+    if(name == "level"){return LEVEL_ORDER;}
+    if(name == "bfs"){return BFS_ORDER;}
+    if(name == "bisect"){return BISECT_ORDER;}
+    if(name == "auto"){return AUTO_ORDER;}
+    fail(std::string("Invalid node order ") + name);
+}
+
+std::string node_order_name(node_order order){
+    switch(order){
+        case DFS_ORDER: return "dfs";
+        case LEVEL_ORDER: return "level";
+        case BFS_ORDER: return "bfs";
+        case BISECT_ORDER: return "bisect";
+        default: return "auto";
     }
-    if(nodes[node_id]->is_false()){
-        false_node_id = new_index;
+}
+
+node_order DDNNF::reorder(node_order order){
+    std::vector<int> new_order = std::vector<int>();
+    if(order == AUTO_ORDER){
+        // try every order, computing them is cheaper than one bad layout
+        double best_span = -1;
+        node_order candidates[] = {DFS_ORDER,LEVEL_ORDER,BFS_ORDER,BISECT_ORDER};
+        for(node_order candidate: candidates){
+            std::vector<int> candidate_order = std::vector<int>();
+            compute_order(candidate,candidate_order);
+            double span = order_edge_span(candidate_order);
+            if(best_span < 0 || span < best_span){
+                best_span = span;
+                order = candidate;
+                new_order.swap(candidate_order);
+            }
+        }
+    }else{
+        compute_order(order,new_order);
     }
+    apply_order(new_order,std::vector<int>());
+    return order;
+}
 
-    // update old to new indexes map
-    old_to_new_indexes.insert(std::make_pair(old_index,new_index));
-    
-    // recompute children indexes
-    std::set<int> children_to_add = std::set<int>();
-    for(auto child_id: children){
-        // add children to children to add
-        children_to_add.insert(old_to_new_indexes[child_id]);
+void DDNNF::compute_order(node_order order, std::vector<int>& new_order)const{
+    new_order.clear();
+    switch(order){
+        case LEVEL_ORDER:{
+            std::vector<int> level_starts = std::vector<int>();
+            compute_levels(new_order,level_starts);
+        } break;
+        case BFS_ORDER:{
+            // a node is queued once all its parents are taken, so reversing
+            // the queue order puts children before parents
+            std::vector<int> parents_left = std::vector<int>(nodes.size());
+            for(auto node: nodes){
+                parents_left[node->get_id()] = node->get_parents().size();
+            }
+            std::queue<int> ready = std::queue<int>();
+            ready.push(root_id);
+            while(!ready.empty()){
+                int node_id = ready.front();
+                ready.pop();
+                new_order.push_back(node_id);
+                for(auto child: nodes[node_id]->get_children()){
+                    if(--parents_left[child] == 0){ready.push(child);}
+                }
+            }
+            std::reverse(new_order.begin(),new_order.end());
+        } break;
+        case BISECT_ORDER:{
+            // sub-DAG sizes counted as trees, saturating on shared nodes
+            std::vector<uint64_t> sizes = std::vector<uint64_t>(nodes.size(),1);
+            for(auto node: nodes){
+                uint64_t size = 1;
+                for(auto child: node->get_children()){
+                    size = std::min(size + sizes[child],(uint64_t)nodes.size());
+                }
+                sizes[node->get_id()] = size;
+            }
+            std::vector<bool> visited = std::vector<bool>(nodes.size(),false);
+            bisect_order_rec(root_id,sizes,visited,new_order);
+        } break;
+        default:{
+            std::vector<bool> visited = std::vector<bool>(nodes.size(),false);
+            recompute_indexes_rec(root_id,visited,new_order);
+        }
+    }
+}
 
-        // remove old node is from children's parents
-        nodes[child_id]->remove_parent(old_index);
+void DDNNF::bisect_order_rec(int node_id, const std::vector<uint64_t>& sizes, std::vector<bool>& visited, std::vector<int>& new_order)const{
+    if(visited[node_id]){return;}
+    visited[node_id] = true;
+    // smaller sub-DAGs first, so that the largest one ends next to the node
+    std::vector<int> children = std::vector<int>(nodes[node_id]->get_children().begin(),nodes[node_id]->get_children().end());
+    std::stable_sort(children.begin(),children.end(),[&](int a, int b){return sizes[a] < sizes[b];});
+    for(auto child: children){
+        bisect_order_rec(child,sizes,visited,new_order);
+    }
+    new_order.push_back(node_id);
+}
 
-        // add parent as -new_index
-        // because new_index may already point to 
-        // a different node
-        nodes[child_id]->add_parent(-new_index);
+double DDNNF::order_edge_span(const std::vector<int>& new_order)const{
+    std::vector<int> positions = std::vector<int>(nodes.size());
+    for(int position = 0; position < (int)new_order.size(); position++){
+        positions[new_order[position]] = position;
     }
+    double total_span = 0;
+    long edges = 0;
+    for(auto node: nodes){
+        for(auto child: node->get_children()){
+            total_span += positions[node->get_id()] - positions[child];
+            edges++;
+        }
+    }
+    return edges == 0 ? 0 : total_span / edges;
+}
 
-    // update children of node
-    // IMPORTANT!!!: first clear children then add all changes
-    nodes[node_id]->remove_all_children();
-    for(auto child: children_to_add){
-        nodes[node_id]->add_child(child);
+double DDNNF::average_edge_span()const{
+    // span of the current layout
+    std::vector<int> order = std::vector<int>();
+    for(auto node: nodes){
+        order.push_back(node->get_id());
     }
+    return order_edge_span(order);
 }
 
 void DDNNF::remove_unreferenced_nodes(){
@@ -953,7 +1502,7 @@ void DDNNF::remove_unreferenced_nodes(){
         if(node == nullptr){continue;}
         // root node is the only unreferenced node
         // that we have to keep
-        if(node->is_root()){continue;}
+        if(is_root(node->get_id())){continue;}
         // node is referenced by some parent
         if(node->get_parents().size() != 0){continue;}
         // node is not referenced by any parent, 
@@ -965,10 +1514,10 @@ void DDNNF::remove_unreferenced_nodes(){
     while(!unreferenced_node_ids.empty()){
         int node_to_delete_id = unreferenced_node_ids.front();
         unreferenced_node_ids.pop();
-        DDNNFNode* node = nodes[node_to_delete_id];
+        const DDNNFNode* node = nodes[node_to_delete_id];
         // update literals map
         if(node->is_literal()){
-            literals[node->get_var()] = -1;
+            literals.mut()[node->get_var()] = -1;
         }
         // update true and false node ids
         if(node->is_true()){true_node_id = -1;}
@@ -976,7 +1525,7 @@ void DDNNF::remove_unreferenced_nodes(){
 
         // remove node from all children parents
         for(auto child: node->get_children()){
-            nodes[child]->remove_parent(node_to_delete_id);
+            nodes.mut(child)->remove_parent(node_to_delete_id);
             // if child has no parents, it is a new
             // unreferenced root, so add it to
             // unreferenced_node_ids
@@ -985,8 +1534,8 @@ void DDNNF::remove_unreferenced_nodes(){
             }
         }
         // now its safe to delete node
-        nodes[node_to_delete_id] = nullptr;
-        delete node;
+        nodes.remove(node_to_delete_id);
+        if(stats != nullptr){stats->unreferenced_removed++;}
     }
 }
 
@@ -1016,13 +1565,13 @@ void DDNNF::simplify_truth_rec(int node_id, std::vector<bool>& visited){
             for(auto child: children){
                 // if any child is true, remove child
                 if(nodes[child]->is_true()){
-                    nodes[child]->remove_parent(node_id);
+                    nodes.mut(child)->remove_parent(node_id);
                     true_children_ids.insert(child);
                 }else if(nodes[child]->is_false()){
                     // if any child is false, node is false
                     node_is_false = true;
                     node_is_true = false;
-                    nodes[child]->remove_parent(node_id);
+                    nodes.mut(child)->remove_parent(node_id);
                 }else{
                     // if any child is not true, node is not true
                     node_is_true = false;
@@ -1032,60 +1581,57 @@ void DDNNF::simplify_truth_rec(int node_id, std::vector<bool>& visited){
                 // remove node from all parents children
                 // and add edge from parent to false node
                 for(auto parent: nodes[node_id]->get_parents()){
-                    nodes[parent]->remove_child(node_id);
+                    nodes.mut(parent)->remove_child(node_id);
                     add_edge(parent,false_node_id);
                 }
-                if(nodes[node_id]->is_root()){
+                if(is_root(node_id)){
                     root_id = false_node_id;
                 }
                 // have all nodes children forget their parent
                 for(auto child: nodes[node_id]->get_children()){
-                    nodes[child]->remove_parent(node_id);
+                    nodes.mut(child)->remove_parent(node_id);
                 }
                 // delete node
-                DDNNFNode* old_node = nodes[node_id];
-                nodes[node_id] = nullptr;
-                delete old_node;
+                nodes.remove(node_id);
+                if(stats != nullptr){stats->constants_propagated++;}
                 return;
             }
             if(node_is_true){
                 // remove node from all parents children
                 // and add edge from parent to true node
                 for(auto parent: nodes[node_id]->get_parents()){
-                    nodes[parent]->remove_child(node_id);
+                    nodes.mut(parent)->remove_child(node_id);
                     add_edge(parent,true_node_id);
                 }
-                if(nodes[node_id]->is_root()){
+                if(is_root(node_id)){
                     root_id = true_node_id;
                 }
                 // have all nodes children forget their parent
                 for(auto child: nodes[node_id]->get_children()){
-                    nodes[child]->remove_parent(node_id);
+                    nodes.mut(child)->remove_parent(node_id);
                 }
                 // delete node
-                DDNNFNode* old_node = nodes[node_id];
-                nodes[node_id] = nullptr;
-                delete old_node;
+                nodes.remove(node_id);
+                if(stats != nullptr){stats->constants_propagated++;}
                 return;
             }
             // remove true children
             for(auto true_child: true_children_ids){
-                nodes[node_id]->remove_child(true_child);
+                nodes.mut(node_id)->remove_child(true_child);
             }
             if(nodes[node_id]->get_children().size() == 1){
                 // node is not necessary
                 int non_true_child = *nodes[node_id]->get_children().begin();
-                nodes[non_true_child]->remove_parent(node_id); 
+                nodes.mut(non_true_child)->remove_parent(node_id); 
                 for(auto parent: nodes[node_id]->get_parents()){
-                    nodes[parent]->remove_child(node_id);
+                    nodes.mut(parent)->remove_child(node_id);
                     add_edge(parent,non_true_child);
                 }
-                if(nodes[node_id]->is_root()){
+                if(is_root(node_id)){
                     root_id = non_true_child;
                 }
-                DDNNFNode* old_node = nodes[node_id];
-                nodes[node_id] = nullptr;
-                delete old_node;
+                nodes.remove(node_id);
+                if(stats != nullptr){stats->single_children_bypassed++;}
                 return;
             }
             // if any child is AND, merge child with node
@@ -1094,16 +1640,15 @@ void DDNNF::simplify_truth_rec(int node_id, std::vector<bool>& visited){
                 if(nodes[child]->get_type() == DDNNF_AND && 
                     nodes[child]->get_parents().size() == 1){
                     // remove edge from node to child
-                    nodes[node_id]->remove_child(child);
+                    nodes.mut(node_id)->remove_child(child);
                     // add children of child to node
                     for(auto grandchild: nodes[child]->get_children()){
                         add_edge(node_id,grandchild);
-                        nodes[grandchild]->remove_parent(child);
+                        nodes.mut(grandchild)->remove_parent(child);
                     }
                     // remove child
-                    DDNNFNode* old_child = nodes[child];
-                    nodes[child] = nullptr;
-                    delete old_child;
+                    nodes.remove(child);
+                    if(stats != nullptr){stats->children_merged++;}
                 }
             }
         }break;
@@ -1114,11 +1659,11 @@ void DDNNF::simplify_truth_rec(int node_id, std::vector<bool>& visited){
             for(auto child: children){
                 // if any child is false, remove child
                 if(nodes[child]->is_false()){
-                    nodes[child]->remove_parent(node_id);
+                    nodes.mut(child)->remove_parent(node_id);
                     false_children_ids.insert(child);
                 }else if(nodes[child]->is_true()){
                     // if any child is true, node is true
-                    nodes[child]->remove_parent(node_id);
+                    nodes.mut(child)->remove_parent(node_id);
                     node_is_true = true;
                     node_is_false = false;
                 }else{
@@ -1130,81 +1675,75 @@ void DDNNF::simplify_truth_rec(int node_id, std::vector<bool>& visited){
                 // remove node from all parents children
                 // and add edge from parent to true node
                 for(auto parent: nodes[node_id]->get_parents()){
-                    nodes[parent]->remove_child(node_id);
+                    nodes.mut(parent)->remove_child(node_id);
                     add_edge(parent,true_node_id);
                 }
-                if(nodes[node_id]->is_root()){
+                if(is_root(node_id)){
                     root_id = true_node_id;
                 }
                 // have all nodes children forget their parent
                 for(auto child: nodes[node_id]->get_children()){
-                    nodes[child]->remove_parent(node_id);
+                    nodes.mut(child)->remove_parent(node_id);
                 }
                 // delete node
-                DDNNFNode* old_node = nodes[node_id];
-                nodes[node_id] = nullptr;
-                delete old_node;
+                nodes.remove(node_id);
+                if(stats != nullptr){stats->constants_propagated++;}
                 return;
             }
             if(node_is_false){
                 // remove node from all parents children
                 // and add edge from parent to false node
                 for(auto parent: nodes[node_id]->get_parents()){
-                    nodes[parent]->remove_child(node_id);
+                    nodes.mut(parent)->remove_child(node_id);
                     add_edge(parent,false_node_id);
                 }
-                if(nodes[node_id]->is_root()){
+                if(is_root(node_id)){
                     root_id = false_node_id;
                 }
                 // have all nodes children forget their parent
                 for(auto child: nodes[node_id]->get_children()){
-                    nodes[child]->remove_parent(node_id);
+                    nodes.mut(child)->remove_parent(node_id);
                 }
                 // delete node
-                DDNNFNode* old_node = nodes[node_id];
-                nodes[node_id] = nullptr;
-                delete old_node;
+                nodes.remove(node_id);
+                if(stats != nullptr){stats->constants_propagated++;}
                 return;
             }
             // remove false children
             for(auto false_child: false_children_ids){
-                nodes[node_id]->remove_child(false_child);
+                nodes.mut(node_id)->remove_child(false_child);
             }
             if(nodes[node_id]->get_children().size() == 1){
                 // node is not necessary
                 int non_false_child = *nodes[node_id]->get_children().begin();
-                nodes[non_false_child]->remove_parent(node_id); 
+                nodes.mut(non_false_child)->remove_parent(node_id); 
                 for(auto parent: nodes[node_id]->get_parents()){
-                    nodes[parent]->remove_child(node_id);
+                    nodes.mut(parent)->remove_child(node_id);
                     add_edge(parent,non_false_child);
                 }
-                if(nodes[node_id]->is_root()){
+                if(is_root(node_id)){
                     root_id = non_false_child;
                 }
-                DDNNFNode* old_node = nodes[node_id];
-                nodes[node_id] = nullptr;
-                delete old_node;
+                nodes.remove(node_id);
+                if(stats != nullptr){stats->single_children_bypassed++;}
                 return;
             }
             // if any child is OR, merge child with node
             children = nodes[node_id]->get_children();
             for(auto child: children){
                 if(nodes[child]->get_type() == DDNNF_OR && nodes[child]->get_parents().size() == 1){
+                    // merged node is no longer a decision on a single variable
+                    nodes.mut(node_id)->set_decision_var(0);
                     // remove edge from node to child
-                    nodes[node_id]->remove_child(child);
+                    nodes.mut(node_id)->remove_child(child);
                     // add children of child to node
                     for(auto grandchild: nodes[child]->get_children()){
                         add_edge(node_id,grandchild);
-                        nodes[grandchild]->remove_parent(child);
+                        nodes.mut(grandchild)->remove_parent(child);
                     }
                     // remove child
-                    if(child == 57){
-                        std::cout<<"NODE 57 WAS DELETED CAUS CHILD OF MERGE"<<std::endl;
-                        std::cout.flush();
-                    }
-                    DDNNFNode* old_child = nodes[child];
-                    nodes[child] = nullptr;
-                    delete old_child;
+                    nodes.remove(child);
+                    if(stats != nullptr){stats->children_merged++;}
                 }
             }
         }break;
@@ -1212,66 +1751,14 @@ void DDNNF::simplify_truth_rec(int node_id, std::vector<bool>& visited){
 }
 
 DDNNF DDNNF::clone()const{
-    DDNNF new_ddnnf = DDNNF();
-    new_ddnnf.nodes = std::vector<DDNNFNode*>();
-    new_ddnnf.literals = std::map<int,int>();
-    new_ddnnf.mentioned_vars = std::set<int>();
-    new_ddnnf.true_node_id = true_node_id;
-    new_ddnnf.false_node_id = false_node_id;
-    new_ddnnf.root_id = root_id;
-    new_ddnnf.total_variables = total_variables;
-    new_ddnnf.prepare_literals(total_variables);
-    // clone nodes
-    for(auto node: nodes){
-        new_ddnnf.nodes.push_back(new DDNNFNode(node->get_id(),&new_ddnnf,node->get_type(),node->get_var()));
-        for(auto child: node->get_children()){
-            new_ddnnf.nodes[node->get_id()]->add_child(child);
-        }
-        for(auto parent: node->get_parents()){
-            new_ddnnf.nodes[node->get_id()]->add_parent(parent);
-        }
-        if(node->is_literal()){
-            new_ddnnf.literals[node->get_var()] = node->get_id();
-            new_ddnnf.mentioned_vars.insert(abs(node->get_var()));
-        }
-    }
-    // clone mentioned vars
-    for(auto var: mentioned_vars){
-        new_ddnnf.mentioned_vars.insert(var);
-    }
-    return new_ddnnf;
+    // nodes and the literal and variable maps are shared with the
+    // clone and copied only when one of the two modifies them
+    return DDNNF(*this);
 }
 
 
 DDNNF* DDNNF::clone_ptr()const{
-    DDNNF* new_ddnnf = new DDNNF();
-    new_ddnnf->nodes = std::vector<DDNNFNode*>();
-    new_ddnnf->literals = std::map<int,int>();
-    new_ddnnf->mentioned_vars = std::set<int>();
-    new_ddnnf->true_node_id = true_node_id;
-    new_ddnnf->false_node_id = false_node_id;
-    new_ddnnf->root_id = root_id;
-    new_ddnnf->total_variables = total_variables;
-    new_ddnnf->prepare_literals(total_variables);
-    // clone nodes
-    for(auto node: nodes){
-        new_ddnnf->nodes.push_back(new DDNNFNode(node->get_id(),new_ddnnf,node->get_type(),node->get_var()));
-        for(auto child: node->get_children()){
-            new_ddnnf->nodes[node->get_id()]->add_child(child);
-        }
-        for(auto parent: node->get_parents()){
-            new_ddnnf->nodes[node->get_id()]->add_parent(parent);
-        }
-        if(node->is_literal()){
-            new_ddnnf->literals[node->get_var()] = node->get_id();
-            new_ddnnf->mentioned_vars.insert(abs(node->get_var()));
-        }
-    }
-    // clone mentioned vars
-    for(auto var: mentioned_vars){
-        new_ddnnf->mentioned_vars.insert(var);
-    }
-    return new_ddnnf;
+    return new DDNNF(*this);
 }
 
 // void DDNNF::enumerate()const{
@@ -1424,7 +1911,7 @@ DDNNF* DDNNF::clone_ptr()const{
 //     }
 // }
 
-void DDNNF::serialize_c2d(const char * filename)const{
+void DDNNF::serialize_c2d(std::ostream& out)const{
     // clone ddnnf and modify clone to be c2d serializable
     DDNNF cloned_ddnnf = clone();
     std::vector<bool> visited = std::vector<bool>(cloned_ddnnf.nodes.size(),false);
@@ -1432,7 +1919,7 @@ void DDNNF::serialize_c2d(const char * filename)const{
     cloned_ddnnf.recompute_indexes();
     cloned_ddnnf.recompute_mentioned_vars();
     // now cloned ddnnf can be serialized as a normal ddnnf
-    cloned_ddnnf.serialize(filename);
+    cloned_ddnnf.serialize(out);
 }
 
 void DDNNF::make_c2d_rec(int node_id, std::vector<bool>& visited){
@@ -1447,6 +1934,8 @@ void DDNNF::make_c2d_rec(int node_id, std::vector<bool>& visited){
             // split OR node into multiple OR nodes
             // with only two children
             if(children.size() <= 2){return;}
+            // split node is not a decision on a single variable
+            nodes.mut(node_id)->set_decision_var(0);
             std::queue<int> children_id_queue = std::queue<int>();
             for(auto child: children){
                 children_id_queue.push(child);
@@ -1466,10 +1955,10 @@ void DDNNF::make_c2d_rec(int node_id, std::vector<bool>& visited){
                 children_id_queue.pop();
 
                 // remove old edges
-                nodes[node_id]->remove_child(first);
-                nodes[first]->remove_parent(node_id);
-                nodes[node_id]->remove_child(second);
-                nodes[second]->remove_parent(node_id);
+                nodes.mut(node_id)->remove_child(first);
+                nodes.mut(first)->remove_parent(node_id);
+                nodes.mut(node_id)->remove_child(second);
+                nodes.mut(second)->remove_parent(node_id);
 
                 // create OR node
                 int new_node_id = add_node(DDNNF_OR,0);
@@ -1487,39 +1976,35 @@ void DDNNF::make_c2d_rec(int node_id, std::vector<bool>& visited){
     }
 }
 
-void DDNNF::serialize_d4(const char * filename)const{
-    std::ofstream out(filename);
-    
+void DDNNF::serialize_d4(std::ostream& out)const{
     // a simplified ddnnf has true or false only as root
     if(false_node_id != -1){
-        out<<"f 1 0"<<std::endl;
-        out.close();
+        out<<"f 1 0\n";
         return;
     }
     if(true_node_id != -1){
-        out<<"t 1 0"<<std::endl;
-        out.close();
+        out<<"t 1 0\n";
         return;
     }
 
     // print nodes with ids shifted by 1
     int count = 1;
     std::map<int,int> node_id_to_d4_id = std::map<int,int>();
-    for(auto iter=nodes.rbegin(); iter!=nodes.rend(); ++iter){
-        auto node = *iter;
+    for(int node_id = nodes.size() - 1; node_id >= 0; node_id--){
+        const DDNNFNode* node = nodes[node_id];
         node_id_to_d4_id[node->get_id()] = count;
         // root will have index 1 always
         switch(node->get_type()){
             // skip serializing root
             case DDNNF_AND:{
-                out<<"a "<<count<<" 0"<<std::endl;
+                out<<"a "<<count<<" 0\n";
             }break;
             case DDNNF_OR:{
-                out<<"o "<<count<<" 0"<<std::endl;
+                out<<"o "<<count<<" 0\n";
             }break;
             case DDNNF_LITERAL:{
                 // wrap literal L in OR(L)
-                out<<"o "<<count<<" 0"<<std::endl;
+                out<<"o "<<count<<" 0\n";
             }break;
             default:{
                 // this should be unreachable
@@ -1528,22 +2013,590 @@ void DDNNF::serialize_d4(const char * filename)const{
         count++;
     }
     int fake_true_node_id = count;
-    out<<"t "<<fake_true_node_id<<" 0"<<std::endl;
+    out<<"t "<<fake_true_node_id<<" 0\n";
 
     // print edges
-    for(DDNNFNode* node: nodes){
+    for(const DDNNFNode* node: nodes){
         int node_d4_id = node_id_to_d4_id[node->get_id()];
         if(node->is_literal()){
             // fake sending literal to true and add literal id
-            out<<node_d4_id<<" "<<fake_true_node_id<<" "<<node->get_var()<<" 0"<<std::endl;
+            out<<node_d4_id<<" "<<fake_true_node_id<<" "<<node->get_var()<<" 0\n";
         }else{
             for(auto child: node->get_children()){
                 int child_d4_id = node_id_to_d4_id[child];
-                out<<node_d4_id<<" "<<child_d4_id<<" 0"<<std::endl;
+                out<<node_d4_id<<" "<<child_d4_id<<" 0\n";
             }
         }
     }
+}
 
-    // close stream
-    out.close();
+void DDNNF::compute_levels(std::vector<int>& level_nodes, std::vector<int>& level_starts)const{
+    // the level of a node is one more than the highest level of its
+    // children, so the nodes of a level never depend on each other
+    std::vector<int> levels = std::vector<int>(nodes.size(),0);
+    int level_count = 0;
+    for(auto node: nodes){
+        int level = 0;
+        for(auto child: node->get_children()){
+            level = std::max(level,levels[child] + 1);
+        }
+        levels[node->get_id()] = level;
+        level_count = std::max(level_count,level + 1);
+    }
+    // counting sort by level, keeping the storage order inside a level
+    level_starts = std::vector<int>(level_count + 1,0);
+    for(int level: levels){
+        level_starts[level + 1]++;
+    }
+    for(int level = 0; level < level_count; level++){
+        level_starts[level + 1] += level_starts[level];
+    }
+    std::vector<int> next = std::vector<int>(level_starts.begin(),level_starts.end() - 1);
+    level_nodes = std::vector<int>(nodes.size());
+    for(size_t node_id = 0; node_id < levels.size(); node_id++){
+        level_nodes[next[levels[node_id]]++] = node_id;
+    }
+}
+
+void DDNNF::plan_evaluation(int threads, EvaluationPlan& plan)const{
+    plan = EvaluationPlan();
+    plan.threads = 1;
+    if(threads <= 1 || (int)nodes.size() < LEVEL_PARALLEL_THRESHOLD){return;}
+    plan.threads = threads;
+    compute_levels(plan.level_nodes,plan.level_starts);
+    plan.pool = std::make_shared<WorkStealingPool>(threads);
+}
+
+void DDNNF::evaluate_bottom_up(const EvaluationPlan& plan, const std::function<void(int)>& visit)const{
+    if(plan.threads <= 1){
+        // nodes are stored children first (see recompute_indexes)
+        for(auto node: nodes){
+            visit(node->get_id());
+        }
+        return;
+    }
+    const std::vector<int>& level_nodes = plan.level_nodes;
+    const std::vector<int>& level_starts = plan.level_starts;
+    for(size_t level = 0; level + 1 < level_starts.size(); level++){
+        int start = level_starts[level];
+        int width = level_starts[level + 1] - start;
+        if(width < LEVEL_PARALLEL_THRESHOLD){
+            for(int i = start; i < start + width; i++){
+                visit(level_nodes[i]);
+            }
+            continue;
+        }
+        int chunk_size = std::max(LEVEL_MIN_CHUNK,width / (plan.threads * LEVEL_CHUNKS_PER_THREAD));
+        plan.pool->run(width,chunk_size,[&](int first, int last){
+            for(int i = start + first; i < start + last; i++){
+                visit(level_nodes[i]);
+            }
+        });
+    }
+}
+
+void DDNNF::compute_var_counts(std::vector<int>& var_counts, const EvaluationPlan& plan)const{
+    std::vector<VarSet> var_sets = std::vector<VarSet>(nodes.size());
+    std::vector<std::atomic<int>> parents_left = std::vector<std::atomic<int>>(nodes.size());
+    for(auto node: nodes){
+        parents_left[node->get_id()] = node->get_parents().size();
+    }
+    var_counts = std::vector<int>(nodes.size(),0);
+    evaluate_bottom_up(plan,[&](int node_id){
+        const DDNNFNode* node = nodes[node_id];
+        VarSet& vars = var_sets[node_id];
+        if(node->is_literal()){
+            vars.insert(abs(node->get_var()));
+        }
+        for(auto child: node->get_children()){
+            // children of AND nodes are disjoint, but OR children may overlap
+            vars.unite(var_sets[child]);
+            // free the set of a child once all its parents have used it
+            if(parents_left[child].fetch_sub(1) == 1){
+                var_sets[child].clear();
+            }
+        }
+        var_counts[node_id] = vars.size();
+    });
+}
+
+std::vector<BigInt> DDNNF::cardinality_counts(int threads)const{
+    // every node is mapped to the polynomial sum_k c_k x^k where c_k
+    // is the number of models over the node variables with k true variables;
+    // coefficients are computed modulo enough primes to rebuild them exactly
+    int n = total_variables;
+    // each coefficient is at most 2^n, primes are larger than 2^61
+    int prime_count = n / (MODULAR_PRIME_BITS - 1) + 1;
+    int log_size = 0;
+    while((1 << log_size) < n + 1){log_size++;}
+    std::vector<NTTPrime> primes = find_ntt_primes(prime_count,log_size);
+
+    // factorials to build the binomial padding (1+x)^gap
+    std::vector<std::vector<uint64_t>> factorials = std::vector<std::vector<uint64_t>>(prime_count);
+    std::vector<std::vector<uint64_t>> inverse_factorials = std::vector<std::vector<uint64_t>>(prime_count);
+    for(int i = 0; i < prime_count; i++){
+        uint64_t p = primes[i].prime;
+        factorials[i] = std::vector<uint64_t>(n + 1,1);
+        inverse_factorials[i] = std::vector<uint64_t>(n + 1,1);
+        for(int k = 1; k <= n; k++){
+            factorials[i][k] = mod_mul(factorials[i][k - 1],k,p);
+        }
+        inverse_factorials[i][n] = mod_inv(factorials[i][n],p);
+        for(int k = n; k > 0; k--){
+            inverse_factorials[i][k - 1] = mod_mul(inverse_factorials[i][k],k,p);
+        }
+    }
+    auto pad = [&](const std::vector<uint64_t>& poly, int gap, int prime_index){
+        if(gap == 0 || poly.empty()){return poly;}
+        uint64_t p = primes[prime_index].prime;
+        std::vector<uint64_t> binomial = std::vector<uint64_t>(gap + 1);
+        for(int k = 0; k <= gap; k++){
+            binomial[k] = mod_mul(factorials[prime_index][gap],mod_mul(inverse_factorials[prime_index][k],inverse_factorials[prime_index][gap - k],p),p);
+        }
+        return poly_multiply(poly,binomial,primes[prime_index]);
+    };
+
+    std::vector<int> var_counts;
+    EvaluationPlan plan;
+    plan_evaluation(threads,plan);
+    compute_var_counts(var_counts,plan);
+    // the products of large nodes and the reconstruction share one pool,
+    // started once for the whole count
+    std::shared_ptr<WorkStealingPool> pool = plan.pool ? plan.pool : std::make_shared<WorkStealingPool>(threads);
+    auto run_tasks = [&](int count, bool parallel, const std::function<void(int)>& body){
+        if(!parallel){
+            for(int task = 0; task < count; task++){body(task);}
+            return;
+        }
+        pool->run(count,1,[&](int first, int last){
+            for(int task = first; task < last; task++){body(task);}
+        });
+    };
+    std::vector<int> parents_left = std::vector<int>(nodes.size(),0);
+    for(auto node: nodes){
+        parents_left[node->get_id()] = node->get_parents().size();
+    }
+
+    // polys[node][prime] holds the coefficients of the node polynomial
+    typedef std::vector<std::vector<uint64_t>> ModularPoly;
+    std::vector<ModularPoly> polys = std::vector<ModularPoly>(nodes.size());
+    for(auto node: nodes){
+        int node_id = node->get_id();
+        ModularPoly& poly = polys[node_id];
+        poly = ModularPoly(prime_count);
+        const std::set<int>& children = node->get_children();
+        // small nodes are not worth handing to the pool
+        bool parallel_node = var_counts[node_id] >= PARALLEL_POLY_THRESHOLD;
+        switch(node->get_type()){
+            case DDNNF_TRUE:{
+                for(int i = 0; i < prime_count; i++){poly[i] = std::vector<uint64_t>(1,1);}
+            }break;
+            case DDNNF_FALSE:break;
+            case DDNNF_LITERAL:{
+                for(int i = 0; i < prime_count; i++){
+                    if(node->get_var() > 0){
+                        poly[i] = std::vector<uint64_t>{0,1};
+                    }else{
+                        poly[i] = std::vector<uint64_t>{1};
+                    }
+                }
+            }break;
+            case DDNNF_AND:{
+                // balanced product tree: the products inside each round
+                // are independent, and so are the different primes
+                std::vector<ModularPoly> factors = std::vector<ModularPoly>();
+                for(auto child: children){
+                    factors.push_back(polys[child]);
+                }
+                while(factors.size() > 1){
+                    int pairs = factors.size() / 2;
+                    std::vector<ModularPoly> products = std::vector<ModularPoly>(pairs,ModularPoly(prime_count));
+                    run_tasks(pairs * prime_count,parallel_node,[&](int task){
+                        int pair = task / prime_count;
+                        int prime_index = task % prime_count;
+                        products[pair][prime_index] = poly_multiply(factors[2 * pair][prime_index],factors[2 * pair + 1][prime_index],primes[prime_index]);
+                    });
+                    if(factors.size() % 2 == 1){
+                        products.push_back(factors.back());
+                    }
+                    factors.swap(products);
+                }
+                poly = factors[0];
+            }break;
+            case DDNNF_OR:{
+                // children are smoothed by padding them with (1+x)^gap
+                run_tasks(prime_count,parallel_node,[&](int prime_index){
+                    uint64_t p = primes[prime_index].prime;
+                    std::vector<uint64_t>& sum = poly[prime_index];
+                    for(auto child: children){
+                        std::vector<uint64_t> padded = pad(polys[child][prime_index],var_counts[node_id] - var_counts[child],prime_index);
+                        if(padded.size() > sum.size()){sum.resize(padded.size(),0);}
+                        for(size_t k = 0; k < padded.size(); k++){
+                            sum[k] = mod_add(sum[k],padded[k],p);
+                        }
+                    }
+                });
+            }break;
+        }
+        // free children polynomials that are no longer needed
+        for(auto child: children){
+            parents_left[child]--;
+            if(parents_left[child] == 0){
+                ModularPoly().swap(polys[child]);
+            }
+        }
+    }
+
+    // variables not mentioned by the root are free
+    std::vector<std::vector<uint64_t>> root_poly = std::vector<std::vector<uint64_t>>(prime_count);
+    std::vector<uint64_t> prime_values = std::vector<uint64_t>(prime_count);
+    run_tasks(prime_count,true,[&](int prime_index){
+        root_poly[prime_index] = pad(polys[root_id][prime_index],n - var_counts[root_id],prime_index);
+        root_poly[prime_index].resize(n + 1,0);
+        prime_values[prime_index] = primes[prime_index].prime;
+    });
+
+    std::vector<BigInt> counts = std::vector<BigInt>(n + 1);
+    run_tasks(n + 1,true,[&](int k){
+        std::vector<uint64_t> residues = std::vector<uint64_t>(prime_count);
+        for(int i = 0; i < prime_count; i++){
+            residues[i] = root_poly[i][k];
+        }
+        counts[k] = crt_reconstruct(residues,prime_values);
+    });
+    return counts;
+}
+
+uint64_t DDNNF::model_count_mod(uint64_t prime)const{
+    EvaluationPlan plan;
+    plan_evaluation(1,plan);
+    std::vector<int> var_counts;
+    compute_var_counts(var_counts,plan);
+    return count_models_mod(prime,var_counts,plan);
+}
+
+uint64_t DDNNF::count_models_mod(uint64_t prime, const std::vector<int>& var_counts, const EvaluationPlan& plan)const{
+    // powers of two for smoothing gaps
+    std::vector<uint64_t> powers = std::vector<uint64_t>(total_variables + 1,1 % prime);
+    for(int i = 1; i <= total_variables; i++){
+        powers[i] = mod_add(powers[i - 1],powers[i - 1],prime);
+    }
+    std::vector<uint64_t> values = std::vector<uint64_t>(nodes.size(),0);
+    evaluate_bottom_up(plan,[&](int node_id){
+        const DDNNFNode* node = nodes[node_id];
+        switch(node->get_type()){
+            case DDNNF_TRUE:
+            case DDNNF_LITERAL: values[node_id] = 1 % prime; break;
+            case DDNNF_FALSE: values[node_id] = 0; break;
+            case DDNNF_AND:{
+                uint64_t product = 1 % prime;
+                for(auto child: node->get_children()){
+                    product = mod_mul(product,values[child],prime);
+                }
+                values[node_id] = product;
+            }break;
+            case DDNNF_OR:{
+                uint64_t sum = 0;
+                for(auto child: node->get_children()){
+                    int gap = var_counts[node_id] - var_counts[child];
+                    sum = mod_add(sum,mod_mul(values[child],powers[gap],prime),prime);
+                }
+                values[node_id] = sum;
+            }break;
+        }
+    });
+    // variables not mentioned by the root are free
+    return mod_mul(values[root_id],powers[total_variables - var_counts[root_id]],prime);
+}
+
+BigInt DDNNF::model_count(int bit_bound, int threads)const{
+    // the count never exceeds 2^total_variables
+    if(bit_bound <= 0 || bit_bound > total_variables + 1){
+        bit_bound = total_variables + 1;
+    }
+    // one residue per prime, primes are larger than 2^61
+    int prime_count = bit_bound / (MODULAR_PRIME_BITS - 1) + 1;
+    std::vector<uint64_t> primes = find_primes(prime_count);
+    // variable counts do not depend on the prime, compute them once
+    EvaluationPlan plan;
+    plan_evaluation(threads,plan);
+    std::vector<int> var_counts;
+    compute_var_counts(var_counts,plan);
+    std::vector<uint64_t> residues = std::vector<uint64_t>(prime_count);
+    if(threads >= 2 * prime_count){
+        // too few primes to keep the threads busy: one prime after
+        // the other, the levels of the circuit are split instead
+        for(int prime_index = 0; prime_index < prime_count; prime_index++){
+            residues[prime_index] = count_models_mod(primes[prime_index],var_counts,plan);
+        }
+    }else{
+        // the primes are independent
+        EvaluationPlan sequential;
+        plan_evaluation(1,sequential);
+        parallel_for(prime_count,threads,[&](int prime_index){
+            residues[prime_index] = count_models_mod(primes[prime_index],var_counts,sequential);
+        });
+    }
+    return crt_reconstruct(residues,primes);
+}
+
+uint64_t DDNNF::weighted_count_mod(const std::vector<uint64_t>& weights, uint64_t prime, int threads)const{
+    EvaluationPlan plan;
+    plan_evaluation(threads,plan);
+    return weighted_count_mod(weights,prime,plan);
+}
+
+uint64_t DDNNF::weighted_count_mod(const std::vector<uint64_t>& weights, uint64_t prime, const EvaluationPlan& plan)const{
+    // weights[v] is the weight of literal v, literal -v gets 1 - weights[v]:
+    // since the two weights of a variable sum to one, missing variables
+    // contribute a factor 1 and no smoothing is needed
+    // check the weights first, nodes may be visited by several threads
+    for(auto node: nodes){
+        if(node->is_literal() && abs(node->get_var()) >= (int)weights.size()){
+            fail(std::string("Missing weight for variable ") + std::to_string(abs(node->get_var())));
+        }
+    }
+    std::vector<uint64_t> values = std::vector<uint64_t>(nodes.size(),0);
+    evaluate_bottom_up(plan,[&](int node_id){
+        const DDNNFNode* node = nodes[node_id];
+        switch(node->get_type()){
+            case DDNNF_TRUE: values[node_id] = 1 % prime; break;
+            case DDNNF_FALSE: values[node_id] = 0; break;
+            case DDNNF_LITERAL:{
+                int var = node->get_var();
+                uint64_t weight = weights[abs(var)] % prime;
+                values[node_id] = var > 0 ? weight : mod_sub(1 % prime,weight,prime);
+            }break;
+            case DDNNF_AND:{
+                uint64_t product = 1 % prime;
+                for(auto child: node->get_children()){
+                    product = mod_mul(product,values[child],prime);
+                }
+                values[node_id] = product;
+            }break;
+            case DDNNF_OR:{
+                uint64_t sum = 0;
+                for(auto child: node->get_children()){
+                    sum = mod_add(sum,values[child],prime);
+                }
+                values[node_id] = sum;
+            }break;
+        }
+    });
+    return values[root_id];
+}
+
+bool DDNNF::is_equivalent(const DDNNF& other, int trials, int threads, double& error_exponent)const{
+    // the weighted count with weights w and 1-w is the unique multilinear
+    // polynomial of the formula, so two formulas are equivalent iff their
+    // polynomials match; by Schwartz-Zippel a random point tells two
+    // different polynomials of degree d apart with probability >= 1 - d/p
+    std::set<int> shared_vars = std::set<int>(mentioned_vars->begin(),mentioned_vars->end());
+    shared_vars.insert(other.mentioned_vars->begin(),other.mentioned_vars->end());
+    int max_var = std::max(total_variables,other.total_variables);
+    if(!shared_vars.empty()){
+        max_var = std::max(max_var,*shared_vars.rbegin());
+    }
+
+    std::vector<uint64_t> primes = find_primes(trials);
+    // both circuits are evaluated once per trial, with the same threads
+    EvaluationPlan plan;
+    plan_evaluation(threads,plan);
+    EvaluationPlan other_plan;
+    other.plan_evaluation(threads,other_plan);
+    std::random_device device;
+    std::mt19937_64 generator(((uint64_t)device() << 32) ^ device());
+    for(int trial = 0; trial < trials; trial++){
+        uint64_t prime = primes[trial];
+        std::uniform_int_distribution<uint64_t> distribution(0,prime - 1);
+        std::vector<uint64_t> weights = std::vector<uint64_t>(max_var + 1,0);
+        for(int var: shared_vars){
+            weights[var] = distribution(generator);
+        }
+        if(weighted_count_mod(weights,prime,plan) != other.weighted_count_mod(weights,prime,other_plan)){
+            error_exponent = 0;
+            return false;
+        }
+    }
+    // error probability is at most (d/p)^trials = 10^error_exponent
+    double degree = std::max((size_t)1,shared_vars.size());
+    error_exponent = trials * (std::log10(degree) - (MODULAR_PRIME_BITS - 1) * std::log10(2.0));
+    return true;
+}
+
+std::vector<bool> DDNNF::are_consistent(const std::vector<std::vector<int>>& terms, int threads)const{
+    // a term is consistent with a DNNF iff the DNNF is satisfiable once
+    // the literals falsified by the term are set to false: one bit per
+    // term, AND/OR nodes combine the bits of their children word by word
+    const int lanes = 64 * QUERY_LANE_WORDS;
+    int batches = (terms.size() + lanes - 1) / lanes;
+    std::vector<bool> results = std::vector<bool>(terms.size(),false);
+    std::vector<std::vector<bool>> batch_results = std::vector<std::vector<bool>>(batches);
+    // with too few batches to keep the threads busy, the batches are
+    // answered one after the other and the levels of the circuit are
+    // split instead, always by the same threads
+    bool split_levels = batches > 0 && threads >= 2 * batches;
+    EvaluationPlan plan;
+    plan_evaluation(split_levels ? threads : 1,plan);
+    auto answer_batch = [&](int batch){
+        int first = batch * lanes;
+        int last = std::min((int)terms.size(),first + lanes);
+        // masks of the lanes whose term contains v (first) or -v (second)
+        std::map<int,std::pair<std::vector<uint64_t>,std::vector<uint64_t>>> term_vars;
+        std::vector<uint64_t> contradictory = std::vector<uint64_t>(QUERY_LANE_WORDS,0);
+        for(int t = first; t < last; t++){
+            int word = (t - first) / 64;
+            uint64_t bit = 1ULL << ((t - first) % 64);
+            for(int literal: terms[t]){
+                auto iter = term_vars.find(abs(literal));
+                if(iter == term_vars.end()){
+                    std::vector<uint64_t> empty = std::vector<uint64_t>(QUERY_LANE_WORDS,0);
+                    iter = term_vars.insert(std::make_pair(abs(literal),std::make_pair(empty,empty))).first;
+                }
+                if(literal > 0){
+                    iter->second.first[word] |= bit;
+                }else{
+                    iter->second.second[word] |= bit;
+                }
+            }
+        }
+        for(auto& item: term_vars){
+            for(int w = 0; w < QUERY_LANE_WORDS; w++){
+                contradictory[w] |= item.second.first[w] & item.second.second[w];
+            }
+        }
+
+        std::vector<uint64_t> values = std::vector<uint64_t>(nodes.size() * QUERY_LANE_WORDS,0);
+        evaluate_bottom_up(plan,[&](int node_id){
+            const DDNNFNode* node = nodes[node_id];
+            uint64_t* value = &values[node_id * QUERY_LANE_WORDS];
+            switch(node->get_type()){
+                case DDNNF_TRUE:{
+                    for(int w = 0; w < QUERY_LANE_WORDS; w++){value[w] = ~0ULL;}
+                }break;
+                case DDNNF_FALSE: break;
+                case DDNNF_LITERAL:{
+                    // a literal is false in the lanes whose term contains its negation
+                    int var = node->get_var();
+                    auto iter = term_vars.find(abs(var));
+                    for(int w = 0; w < QUERY_LANE_WORDS; w++){
+                        value[w] = ~0ULL;
+                        if(iter != term_vars.end()){
+                            value[w] = var > 0 ? ~iter->second.second[w] : ~iter->second.first[w];
+                        }
+                    }
+                }break;
+                case DDNNF_AND:{
+                    for(int w = 0; w < QUERY_LANE_WORDS; w++){value[w] = ~0ULL;}
+                    for(auto child: node->get_children()){
+                        const uint64_t* child_value = &values[child * QUERY_LANE_WORDS];
+                        for(int w = 0; w < QUERY_LANE_WORDS; w++){value[w] &= child_value[w];}
+                    }
+                }break;
+                case DDNNF_OR:{
+                    for(auto child: node->get_children()){
+                        const uint64_t* child_value = &values[child * QUERY_LANE_WORDS];
+                        for(int w = 0; w < QUERY_LANE_WORDS; w++){value[w] |= child_value[w];}
+                    }
+                }break;
+            }
+        });
+
+        const uint64_t* root_value = &values[root_id * QUERY_LANE_WORDS];
+        batch_results[batch] = std::vector<bool>(last - first);
+        for(int t = first; t < last; t++){
+            int word = (t - first) / 64;
+            uint64_t bit = 1ULL << ((t - first) % 64);
+            // a term with complementary literals is never consistent
+            batch_results[batch][t - first] = (root_value[word] & ~contradictory[word] & bit) != 0;
+        }
+    };
+    if(split_levels){
+        for(int batch = 0; batch < batches; batch++){
+            answer_batch(batch);
+        }
+    }else{
+        parallel_for(batches,threads,answer_batch);
+    }
+    for(int batch = 0; batch < batches; batch++){
+        for(size_t i = 0; i < batch_results[batch].size(); i++){
+            results[batch * lanes + i] = batch_results[batch][i];
+        }
+    }
+    return results;
+}
+
+std::vector<bool> DDNNF::are_entailed(const std::vector<std::vector<int>>& clauses, int threads)const{
+    // a clause is entailed iff the negation of the clause,
+    // which is a term, is inconsistent with the DNNF
+    std::vector<std::vector<int>> negated_clauses = std::vector<std::vector<int>>();
+    for(auto& clause: clauses){
+        std::vector<int> term = std::vector<int>();
+        for(int literal: clause){
+            term.push_back(-literal);
+        }
+        negated_clauses.push_back(term);
+    }
+    std::vector<bool> results = are_consistent(negated_clauses,threads);
+    for(size_t i = 0; i < results.size(); i++){
+        results[i] = !results[i];
+    }
+    return results;
+}
+
+void DDNNF::smooth(){
+    // compute variable sets bottom up; every OR child missing
+    // some variables x of its parent is replaced by
+    // AND(child, x or -x, ...), with one shared gadget per variable
+    int original_size = nodes.size();
+    std::vector<VarSet> var_sets = std::vector<VarSet>(original_size);
+    std::vector<int> parents_left = std::vector<int>(original_size,0);
+    for(auto node: nodes){
+        parents_left[node->get_id()] = node->get_parents().size();
+    }
+    std::map<int,int> gadgets = std::map<int,int>(); // variable to gadget OR node id
+    for(int node_id = 0; node_id < original_size; node_id++){
+        const DDNNFNode* node = nodes[node_id];
+        VarSet& vars = var_sets[node_id];
+        if(node->is_literal()){
+            vars.insert(abs(node->get_var()));
+        }
+        std::set<int> children = node->get_children();
+        for(auto child: children){
+            vars.unite(var_sets[child]);
+        }
+        if(node->get_type() == DDNNF_OR){
+            for(auto child: children){
+                std::vector<int> missing_vars = vars.difference(var_sets[child]);
+                if(missing_vars.empty()){continue;}
+                int and_node_id = add_node(DDNNF_AND,0);
+                nodes.mut(node_id)->remove_child(child);
+                nodes.mut(child)->remove_parent(node_id);
+                add_edge(node_id,and_node_id);
+                add_edge(and_node_id,child);
+                for(int var: missing_vars){
+                    if(gadgets.find(var) == gadgets.end()){
+                        // reuse the literal nodes already in the formula
+                        int positive_id = literals->at(var) != -1 ? literals->at(var) : add_node(DDNNF_LITERAL,var);
+                        int negative_id = literals->at(-var) != -1 ? literals->at(-var) : add_node(DDNNF_LITERAL,-var);
+                        int gadget_id = add_node(DDNNF_OR,0);
+                        add_edge(gadget_id,positive_id);
+                        add_edge(gadget_id,negative_id);
+                        gadgets[var] = gadget_id;
+                    }
+                    add_edge(and_node_id,gadgets[var]);
+                }
+            }
+        }
+        // free the set of a child once all its parents have used it
+        for(auto child: children){
+            parents_left[child]--;
+            if(parents_left[child] == 0){
+                var_sets[child].clear();
+            }
+        }
+    }
+    // new nodes were appended after their parents
+    recompute_indexes();
+    recompute_mentioned_vars();
 }
@@ -12,6 +12,11 @@
 #include <cmath>
 #include <queue>
 #include <string>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include "bigint.h"
+#include "parser.h"
 
 enum ddnnf_node_type {
     DDNNF_AND,
@@ -27,11 +32,26 @@ enum file_format {
     DDNNF_FILE
 };
 
+// node layouts, all of them store children before their parents
+enum node_order {
+    DFS_ORDER, // post-order from the root, used after every simplification
+    LEVEL_ORDER, // level by level, see compute_levels
+    BFS_ORDER, // breadth first from the root, siblings end up together
+    BISECT_ORDER, // every sub-DAG contiguous, the largest child right before its parent
+    AUTO_ORDER // the order with the smallest average edge span
+};
+
+// "dfs", "level", "bfs", "bisect" or "auto", exits on other names
+node_order node_order_from_name(const std::string& name);
+std::string node_order_name(node_order order);
+
 // const long MC_TRUE = -1;
 // const long MC_FALSE = -2;
 // const long MC_UNKNOWN = -3;
 
 class DDNNF;
+class DDNNFStats;
+class WorkStealingPool;
 
 // class MCMemoItem{
 //     public:
@@ -45,56 +65,163 @@ class DDNNFNode {
     int id; // node id
     std::set<int> children; // node ids of children
     std::set<int> parents; // node ids of parents
-    DDNNF* manager; // reference to manager
     ddnnf_node_type type;
     int var; // only used for literals
+    // c2d decision variable j, only used for OR nodes (0 if unknown);
+    // conditioning uses it to drop contradicted branches, the queries
+    // evaluate every node once bottom-up and gain nothing from it
+    int decision_var;
 
     public:
-    DDNNFNode(int id,DDNNF* manager,ddnnf_node_type type, int var);
+    DDNNFNode(int id,ddnnf_node_type type, int var);
     ~DDNNFNode();
     void add_child(int child_id);
     void add_parent(int parent_id);
-    bool is_root()const;
     const std::set<int>& get_children()const;
     const std::set<int>& get_parents()const;
     void remove_child(int child_id);
     void remove_parent(int parent_id);
     ddnnf_node_type get_type()const;
     int get_var()const;
+    int get_decision_var()const;
+    void set_decision_var(int decision_var);
+    void set_var(int var);
     int get_id()const;
     void set_id(int id);
     bool is_literal()const;
     bool is_true()const;
     bool is_false()const;
     void remove_all_children();
-    void change_parents_sign();
+    void set_children(const std::set<int>& children);
+    void set_parents(const std::set<int>& parents);
     void printNodeDetails()const;
 };
 
+// Copy-on-write value: copies share it until one of them calls mut,
+// which copies a shared value first
+template<class T> class SharedValue{
+    private:
+    std::shared_ptr<T> data;
+
+    public:
+    SharedValue(): data(std::make_shared<T>()){}
+    const T& operator*()const{return *data;}
+    const T* operator->()const{return data.get();}
+    T& mut(){
+        if(data.use_count() > 1){
+            data = std::make_shared<T>(*data);
+        }
+        return *data;
+    }
+    // replaces the value, never writing to a shared one
+    void assign(T value){
+        data = std::make_shared<T>(std::move(value));
+    }
+};
+
+// Copy-on-write vector of nodes: copies of a store share the node
+// vector and the nodes themselves, the vector is copied on the first
+// mutation of a shared store and each node on its first mutation
+class DDNNFNodeStore{
+    private:
+    typedef std::vector<std::shared_ptr<DDNNFNode>> NodeVector;
+    std::shared_ptr<NodeVector> data;
+    void detach();
+
+    public:
+    class const_iterator{
+        private:
+        NodeVector::const_iterator iter;
+        public:
+        const_iterator(NodeVector::const_iterator iter);
+        const DDNNFNode* operator*()const;
+        const_iterator& operator++();
+        bool operator!=(const const_iterator& other)const;
+    };
+    DDNNFNodeStore();
+    size_t size()const;
+    const DDNNFNode* operator[](int id)const; // read only access
+    DDNNFNode* mut(int id); // write access, copies shared data first
+    void push_back(DDNNFNode* node);
+    void remove(int id); // leaves a null entry
+    void reorder(const std::vector<int>& order); // keeps only the listed ids, in order
+    void clear();
+    const_iterator begin()const;
+    const_iterator end()const;
+};
+
 class DDNNF{
+    // forests build circuits from their shared nodes
+    friend class DDNNFForest;
     private:
     //Variables
-    std::vector<DDNNFNode*> nodes; //maps node ids to node pointers
+    DDNNFNodeStore nodes; //maps node ids to node pointers
     int root_id; // root node
     int total_variables; // amount of variables
-    std::map<int,int> literals; // maps variable ids to literal node ids
+    // the maps below are shared with copies like the nodes
+    SharedValue<std::map<int,int>> literals; // maps variable ids to literal node ids
     int true_node_id;
     int false_node_id;
-    std::set<int> mentioned_vars;
+    SharedValue<std::set<int>> mentioned_vars;
+    DDNNFStats* stats; // not owned, nullptr when nothing is measured
+    bool simplify_on_load; // false only to time simplify on a raw circuit
+    SharedValue<std::vector<int>> original_variables; // original_variables[v] is the name of v before compact_variables, empty if never compacted
+
+    // progress of a file being loaded chunk by chunk, in file order
+    struct LoadState{
+        file_format format;
+        size_t records; // records loaded so far
+        int last_node_id; // c2d: last node parsed is the root
+        bool found_nodes; // d4
+        int max_literal; // d4
+        int max_defined_node; // d4
+        std::vector<std::pair<int,int>> edges; // d4: edges are added once all nodes exist
+        std::vector<size_t> edge_literal_starts; // d4: literals of edge i are [starts[i],starts[i+1])
+        std::vector<int> edge_literals; // d4
+    };
 
     //Private Methods
     void prepare_literals(int num_vars);
     int add_node(ddnnf_node_type type, int var); // returns node id
     void add_edge(int parent_id, int child_id);
     //void mc_dfs(int node_id, std::vector<MCMemoItem>& memo,const std::map<int,bool>& vars)const;
-    void simplify();
     void simplify_truth_rec(int node_id, std::vector<bool>& visited);
     void remove_unreferenced_nodes();
     void recompute_indexes();
-    void recompute_indexes_rec(int node_id, std::vector<bool>& visited, std::vector<DDNNFNode*>& new_nodes_vector, std::map<int,int>& old_to_new_indexes);
+    void recompute_indexes_rec(int node_id, std::vector<bool>& visited, std::vector<int>& new_order)const;
+    void apply_order(const std::vector<int>& new_order, const std::vector<int>& var_map);
+    void compute_order(node_order order, std::vector<int>& new_order)const;
+    void bisect_order_rec(int node_id, const std::vector<uint64_t>& sizes, std::vector<bool>& visited, std::vector<int>& new_order)const;
+    double order_edge_span(const std::vector<int>& new_order)const;
     void recompute_mentioned_vars();
+    void prune_decisions(int var);
+    // appends the nodes reachable from source_root with their variables
+    // shifted by offset, returns the new id of source_root
+    int copy_sub_dag(const DDNNF& source, int source_root, int offset);
+    bool condition_components(const std::set<int>& vars, int threads);
+    // levels of the circuit and the threads visiting them, prepared once
+    // per query and shared by all of its bottom-up passes; a plan runs
+    // one pass at a time
+    struct EvaluationPlan{
+        int threads; // 1 when the nodes are visited in storage order
+        std::vector<int> level_nodes;
+        std::vector<int> level_starts;
+        std::shared_ptr<WorkStealingPool> pool;
+    };
+    void compute_levels(std::vector<int>& level_nodes, std::vector<int>& level_starts)const;
+    void plan_evaluation(int threads, EvaluationPlan& plan)const;
+    void evaluate_bottom_up(const EvaluationPlan& plan, const std::function<void(int)>& visit)const;
+    void compute_var_counts(std::vector<int>& var_counts, const EvaluationPlan& plan)const;
+    uint64_t count_models_mod(uint64_t prime, const std::vector<int>& var_counts, const EvaluationPlan& plan)const;
+    uint64_t weighted_count_mod(const std::vector<uint64_t>& weights, uint64_t prime, const EvaluationPlan& plan)const;
     //void enumerate_rec(int node_id, std::set<int>& visited, std::map<int,std::vector<std::set<int>*>>& partial_models,std::vector<int>& parents_left)const;
-    void read_file(const char* filename, file_format format);
+    void read_file(const char* filename, file_format format, int threads);
+    void read_stream(std::istream& in, file_format format);
+    void begin_load(LoadState& state, file_format format);
+    static void parse_lines(const char* begin, const char* end, file_format format, ParsedChunk& chunk);
+    void load_mapped_file(const char* filename, LoadState& state, int threads);
+    void load_chunk(const ParsedChunk& chunk, LoadState& state);
+    void finish_load(LoadState& state);
     void reset();
     //serialization options
     void make_c2d_rec(int node_id, std::vector<bool>& visited);
@@ -102,26 +229,86 @@ class DDNNF{
     public:
     DDNNF();
     ~DDNNF();
-    DDNNFNode* get_node(int id);
+    // copies share all nodes until one of them is modified
+    DDNNF(const DDNNF& other);
+    DDNNF(DDNNF&& other);
+    DDNNF& operator=(const DDNNF& other);
+    DDNNF& operator=(DDNNF&& other);
+    const DDNNFNode* get_node(int id)const;
     int get_literal_id(int var);
-    bool is_root(int node_id);
+    bool is_root(int node_id)const;
+    int get_root_id()const;
     // reading files
-    void read_c2d_file(const char* filename);
-    void read_ddnnf_file(const char* filename);
-    void read_d4_file(const char* filename);
+    // "-" reads standard input, gzip and zstd files are recognized and
+    // decompressed, other files are split and tokenized in parallel
+    // when threads > 1
+    void read_c2d_file(const char* filename, int threads);
+    void read_ddnnf_file(const char* filename, int threads);
+    void read_d4_file(const char* filename, int threads);
+    // sequential readers for streams that cannot be mapped or rewound
+    void read_c2d_stream(std::istream& in);
+    void read_ddnnf_stream(std::istream& in);
+    void read_d4_stream(std::istream& in);
+    // binary node files are mapped and loaded without parsing
+    void read_binary_file(const char* filename);
     // serialization
+    // "-" writes to standard output
     void serialize(const char* filename)const;
     void serialize_c2d(const char* filename)const;
     void serialize_d4(const char* filename)const;
+    void serialize(std::ostream& out)const;
+    void serialize_c2d(std::ostream& out)const;
+    void serialize_d4(std::ostream& out)const;
+    void serialize_binary(const char* filename)const;
     // long model_count(const std::set<int>& vars)const;
+    std::vector<BigInt> cardinality_counts(int threads)const;
+    uint64_t model_count_mod(uint64_t prime)const;
+    BigInt model_count(int bit_bound, int threads)const;
+    uint64_t weighted_count_mod(const std::vector<uint64_t>& weights, uint64_t prime, int threads)const;
+    bool is_equivalent(const DDNNF& other, int trials, int threads, double& error_exponent)const;
+    // batch queries, the circuit is not modified
+    std::vector<bool> are_consistent(const std::vector<std::vector<int>>& terms, int threads)const;
+    std::vector<bool> are_entailed(const std::vector<std::vector<int>>& clauses, int threads)const;
     void condition(int var);
-    void condition_all(const std::set<int>& vars);
+    // with threads > 1, literals falling in different children of a root
+    // AND node condition these disjoint components in parallel, each one
+    // conditioned and simplified on its own copy
+    void condition_all(const std::set<int>& vars, int threads);
+    // conjunction with circuits over other variables, under a new root
+    // AND; with offset_variables the variables of every circuit come after
+    // those of the circuits before it, otherwise the circuits must not
+    // mention the same variables. others are cleared as they are copied
+    void conjoin(std::vector<DDNNF>& others, bool offset_variables);
+    // propagates constants, drops unreachable nodes and renumbers the
+    // rest children first; done by every reader and transformation.
+    // Always sequential: components share the store, the constant nodes
+    // and the renumbering, and copying them out to split the work costs
+    // as much as the single linear pass, which conditioning only pays
+    // back by simplifying every copy once per literal
+    void simplify();
+    void smooth();
+    // renumbers the nodes so that bottom-up passes touch nearby ids,
+    // returns the order applied (AUTO_ORDER picks one)
+    node_order reorder(node_order order);
+    // mean id distance between parents and their children
+    double average_edge_span()const;
+    // renames the mentioned variables to 1..m, keeping their order
+    void compact_variables();
+    // maps a literal of the compacted circuit to the original variable
+    int original_literal(int literal)const;
     // cloning
     DDNNF clone()const;
     DDNNF* clone_ptr()const;
     // void enumerate()const;
     long node_count()const;
     long edge_count()const;
+    int get_total_variables()const;
+    // simplification and conditioning record their timings and counters
+    // in stats until set_stats(nullptr), copies share the same stats
+    void set_stats(DDNNFStats* stats);
+    // with false, the readers leave the circuit as read until simplify
+    // is called; nothing else may be done with it before
+    void set_simplify_on_load(bool simplify_on_load);
 
 };
 
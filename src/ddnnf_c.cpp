@@ -0,0 +1,220 @@
+#include "ddnnf_c.h"
+#include "ddnnf.h"
+#include "error.h"
+#include "modular.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+struct ddnnf_circuit{
+    DDNNF ddnnf;
+};
+
+// message of the last error of each thread
+thread_local std::string last_error = std::string();
+
+// runs call, turning errors into DDNNF_ERROR
+int guarded(const std::function<void()>& call){
+    try{
+        call();
+        return DDNNF_OK;
+    }catch(const std::bad_alloc& error){
+        last_error = "Out of memory";
+    }catch(const std::exception& error){
+        last_error = error.what();
+    }
+    return DDNNF_ERROR;
+}
+
+int missing_circuit(){
+    last_error = "No circuit given";
+    return DDNNF_ERROR;
+}
+
+// the modular routines need an odd prime below 2^62
+bool check_prime(uint64_t prime){
+    if(prime % 2 == 0 || prime >= (1ULL << 62) || !is_prime(prime)){
+        last_error = "Modulus " + std::to_string(prime) + " is not an odd prime below 2^62";
+        return false;
+    }
+    return true;
+}
+
+// splits literals into the 0 terminated lines of query files
+std::vector<std::vector<int>> split_lines(const int* literals, size_t count){
+    std::vector<std::vector<int>> lines = std::vector<std::vector<int>>();
+    std::vector<int> line = std::vector<int>();
+    for(size_t i = 0; i < count; i++){
+        if(literals[i] == 0){
+            lines.push_back(line);
+            line.clear();
+        }else{
+            line.push_back(literals[i]);
+        }
+    }
+    if(line.size() > 0){
+        fail("Last line is not closed by 0");
+    }
+    return lines;
+}
+
+int ddnnf_api_version(void){
+    return DDNNF_C_API_VERSION;
+}
+
+const char* ddnnf_last_error(void){
+    return last_error.c_str();
+}
+
+ddnnf_circuit* ddnnf_new(void){
+    errors_throw(true);
+    ddnnf_circuit* circuit = nullptr;
+    guarded([&](){circuit = new ddnnf_circuit();});
+    return circuit;
+}
+
+ddnnf_circuit* ddnnf_clone(const ddnnf_circuit* circuit){
+    if(circuit == nullptr){
+        missing_circuit();
+        return nullptr;
+    }
+    ddnnf_circuit* copy = nullptr;
+    guarded([&](){
+        copy = new ddnnf_circuit();
+        copy->ddnnf = circuit->ddnnf.clone();
+    });
+    return copy;
+}
+
+void ddnnf_free(ddnnf_circuit* circuit){
+    delete circuit;
+}
+
+int ddnnf_load(ddnnf_circuit* circuit, const char* filename, ddnnf_format format, int threads){
+    if(circuit == nullptr){return missing_circuit();}
+    return guarded([&](){
+        // failed loads leave the circuit unchanged
+        DDNNF loaded = DDNNF();
+        switch(format){
+            case DDNNF_FORMAT_LIBRARY: loaded.read_ddnnf_file(filename,threads); break;
+            case DDNNF_FORMAT_C2D: loaded.read_c2d_file(filename,threads); break;
+            case DDNNF_FORMAT_D4: loaded.read_d4_file(filename,threads); break;
+            case DDNNF_FORMAT_BINARY: loaded.read_binary_file(filename); break;
+            default: fail("Unknown format");
+        }
+        circuit->ddnnf = std::move(loaded);
+    });
+}
+
+int ddnnf_load_buffer(ddnnf_circuit* circuit, const char* data, size_t size, ddnnf_format format){
+    if(circuit == nullptr){return missing_circuit();}
+    return guarded([&](){
+        DDNNF loaded = DDNNF();
+        std::istringstream in(std::string(data,size));
+        switch(format){
+            case DDNNF_FORMAT_LIBRARY: loaded.read_ddnnf_stream(in); break;
+            case DDNNF_FORMAT_C2D: loaded.read_c2d_stream(in); break;
+            case DDNNF_FORMAT_D4: loaded.read_d4_stream(in); break;
+            default: fail("Unsupported format for a buffer");
+        }
+        circuit->ddnnf = std::move(loaded);
+    });
+}
+
+int ddnnf_save(const ddnnf_circuit* circuit, const char* filename, ddnnf_format format){
+    if(circuit == nullptr){return missing_circuit();}
+    return guarded([&](){
+        switch(format){
+            case DDNNF_FORMAT_LIBRARY: circuit->ddnnf.serialize(filename); break;
+            case DDNNF_FORMAT_C2D: circuit->ddnnf.serialize_c2d(filename); break;
+            case DDNNF_FORMAT_D4: circuit->ddnnf.serialize_d4(filename); break;
+            case DDNNF_FORMAT_BINARY: circuit->ddnnf.serialize_binary(filename); break;
+            default: fail("Unknown format");
+        }
+    });
+}
+
+int ddnnf_condition(ddnnf_circuit* circuit, const int* literals, size_t count){
+    if(circuit == nullptr){return missing_circuit();}
+    return guarded([&](){
+        // the copy shares the nodes, so the circuit is unchanged on failure
+        DDNNF conditioned = circuit->ddnnf.clone();
+        conditioned.condition_all(std::set<int>(literals,literals + count),1);
+        circuit->ddnnf = std::move(conditioned);
+    });
+}
+
+int ddnnf_smooth(ddnnf_circuit* circuit){
+    if(circuit == nullptr){return missing_circuit();}
+    return guarded([&](){
+        DDNNF smoothed = circuit->ddnnf.clone();
+        smoothed.smooth();
+        circuit->ddnnf = std::move(smoothed);
+    });
+}
+
+long ddnnf_node_count(const ddnnf_circuit* circuit){
+    return circuit == nullptr ? 0 : circuit->ddnnf.node_count();
+}
+
+long ddnnf_edge_count(const ddnnf_circuit* circuit){
+    return circuit == nullptr ? 0 : circuit->ddnnf.edge_count();
+}
+
+int ddnnf_variable_count(const ddnnf_circuit* circuit){
+    return circuit == nullptr ? 0 : circuit->ddnnf.get_total_variables();
+}
+
+char* ddnnf_model_count(const ddnnf_circuit* circuit, int threads){
+    if(circuit == nullptr){
+        missing_circuit();
+        return nullptr;
+    }
+    char* result = nullptr;
+    guarded([&](){
+        // bit bound 0 lets the counter size its primes
+        std::string count = circuit->ddnnf.model_count(0,threads).to_string();
+        result = (char*)malloc(count.size() + 1);
+        if(result == nullptr){throw std::bad_alloc();}
+        memcpy(result,count.c_str(),count.size() + 1);
+    });
+    return result;
+}
+
+void ddnnf_free_string(char* string){
+    free(string);
+}
+
+int ddnnf_model_count_mod(const ddnnf_circuit* circuit, uint64_t prime, uint64_t* result){
+    if(circuit == nullptr){return missing_circuit();}
+    if(!check_prime(prime)){return DDNNF_ERROR;}
+    return guarded([&](){*result = circuit->ddnnf.model_count_mod(prime);});
+}
+
+int ddnnf_weighted_count_mod(const ddnnf_circuit* circuit, const uint64_t* weights, size_t count, uint64_t prime, int threads, uint64_t* result){
+    if(circuit == nullptr){return missing_circuit();}
+    if(!check_prime(prime)){return DDNNF_ERROR;}
+    return guarded([&](){
+        *result = circuit->ddnnf.weighted_count_mod(std::vector<uint64_t>(weights,weights + count),prime,threads);
+    });
+}
+
+int ddnnf_are_consistent(const ddnnf_circuit* circuit, const int* literals, size_t count, int threads, int* results){
+    if(circuit == nullptr){return missing_circuit();}
+    return guarded([&](){
+        std::vector<bool> answers = circuit->ddnnf.are_consistent(split_lines(literals,count),threads);
+        for(size_t i = 0; i < answers.size(); i++){
+            results[i] = answers[i] ? 1 : 0;
+        }
+    });
+}
+
+int ddnnf_are_entailed(const ddnnf_circuit* circuit, const int* literals, size_t count, int threads, int* results){
+    if(circuit == nullptr){return missing_circuit();}
+    return guarded([&](){
+        std::vector<bool> answers = circuit->ddnnf.are_entailed(split_lines(literals,count),threads);
+        for(size_t i = 0; i < answers.size(); i++){
+            results[i] = answers[i] ? 1 : 0;
+        }
+    });
+}
@@ -0,0 +1,76 @@
+#ifndef __DDNNF_C_H__
+#define __DDNNF_C_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// C interface of libddnnf. Circuits are opaque handles, functions
+// returning int give DDNNF_OK or DDNNF_ERROR, the message of the last
+// error of the calling thread is returned by ddnnf_last_error and
+// circuits are left unchanged by failed calls.
+// Once a circuit is created, errors of the library no longer exit the
+// process.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// raised whenever a function or type below changes incompatibly
+#define DDNNF_C_API_VERSION 1
+
+#define DDNNF_OK 0
+#define DDNNF_ERROR (-1)
+
+typedef struct ddnnf_circuit ddnnf_circuit;
+
+typedef enum {
+    DDNNF_FORMAT_LIBRARY, // nnf format of this library
+    DDNNF_FORMAT_C2D,
+    DDNNF_FORMAT_D4,
+    DDNNF_FORMAT_BINARY // binary node files, see binary.h
+} ddnnf_format;
+
+int ddnnf_api_version(void);
+const char* ddnnf_last_error(void);
+
+// an empty circuit, NULL on failure
+ddnnf_circuit* ddnnf_new(void);
+// a copy sharing the nodes of circuit until either is modified
+ddnnf_circuit* ddnnf_clone(const ddnnf_circuit* circuit);
+void ddnnf_free(ddnnf_circuit* circuit);
+
+// "-" reads standard input, compressed files are recognized
+int ddnnf_load(ddnnf_circuit* circuit, const char* filename, ddnnf_format format, int threads);
+// loads a circuit held in memory (binary node files are not supported)
+int ddnnf_load_buffer(ddnnf_circuit* circuit, const char* data, size_t size, ddnnf_format format);
+// "-" writes standard output, except for binary node files
+int ddnnf_save(const ddnnf_circuit* circuit, const char* filename, ddnnf_format format);
+
+// conditions on count literals, at most one per variable
+int ddnnf_condition(ddnnf_circuit* circuit, const int* literals, size_t count);
+int ddnnf_smooth(ddnnf_circuit* circuit);
+
+long ddnnf_node_count(const ddnnf_circuit* circuit);
+long ddnnf_edge_count(const ddnnf_circuit* circuit);
+int ddnnf_variable_count(const ddnnf_circuit* circuit);
+
+// decimal model count, to be released with ddnnf_free_string; NULL on failure
+char* ddnnf_model_count(const ddnnf_circuit* circuit, int threads);
+void ddnnf_free_string(char* string);
+// counts modulo prime, which must be an odd prime below 2^62
+// (DDNNF_ERROR otherwise)
+int ddnnf_model_count_mod(const ddnnf_circuit* circuit, uint64_t prime, uint64_t* result);
+// weights[v] is the weight of literal v for v < count, -v gets 1 - weights[v]
+int ddnnf_weighted_count_mod(const ddnnf_circuit* circuit, const uint64_t* weights, size_t count, uint64_t prime, int threads, uint64_t* result);
+
+// batch queries: literals holds the terms (or clauses) one after the
+// other, each closed by a 0; results gets 1 or 0 for each of them and
+// must have room for as many entries as there are zeros in literals
+int ddnnf_are_consistent(const ddnnf_circuit* circuit, const int* literals, size_t count, int threads, int* results);
+int ddnnf_are_entailed(const ddnnf_circuit* circuit, const int* literals, size_t count, int threads, int* results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
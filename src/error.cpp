@@ -0,0 +1,20 @@
+#include "error.h"
+#include <iostream>
+#include <cstdlib>
+#include <atomic>
+
+std::atomic<bool> throw_errors(false);
+
+DDNNFError::DDNNFError(const std::string& message) : std::runtime_error(message){}
+
+void errors_throw(bool enabled){
+    throw_errors = enabled;
+}
+
+void fail(const std::string& message){
+    if(throw_errors){
+        throw DDNNFError(message);
+    }
+    std::cerr << "Error: " << message << std::endl;
+    exit(1);
+}
@@ -0,0 +1,18 @@
+#ifndef __ERROR_H__
+#define __ERROR_H__
+
+#include <string>
+#include <stdexcept>
+
+// Error raised instead of exiting once errors_throw(true) was called
+class DDNNFError: public std::runtime_error{
+    public:
+    DDNNFError(const std::string& message);
+};
+
+// errors print "Error: <message>" and exit by default, programs
+// embedding the library make them throw DDNNFError instead
+void errors_throw(bool enabled);
+[[noreturn]] void fail(const std::string& message);
+
+#endif
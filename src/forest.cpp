@@ -0,0 +1,326 @@
+#include "forest.h"
+#include "error.h"
+
+void print_forest_error(){
+    fail("File is not in forest format");
+}
+
+DDNNFForest::DDNNFForest(){
+    nodes = std::vector<ForestNode>();
+    free_ids = std::vector<int>();
+    unique = std::unordered_multimap<uint64_t,int>();
+    roots = std::map<std::string,ForestRoot>();
+    total_variables = 0;
+}
+
+uint64_t DDNNFForest::node_hash(ddnnf_node_type type, int var, const std::vector<int>& children){
+    // multiply and xorshift, as splitmix64 does
+    uint64_t hash = (uint64_t)type * 0x9e3779b97f4a7c15ULL ^ (uint32_t)var;
+    for(int child: children){
+        hash = (hash ^ (uint32_t)child) * 0xbf58476d1ce4e5b9ULL;
+        hash ^= hash >> 31;
+    }
+    return hash;
+}
+
+int DDNNFForest::intern(ddnnf_node_type type, int var, const std::vector<int>& children){
+    uint64_t hash = node_hash(type,var,children);
+    auto range = unique.equal_range(hash);
+    for(auto item = range.first; item != range.second; item++){
+        const ForestNode& node = nodes[item->second];
+        if(node.type == type && node.var == var && node.children == children){
+            return item->second;
+        }
+    }
+    int id;
+    if(!free_ids.empty()){
+        id = free_ids.back();
+        free_ids.pop_back();
+    }else{
+        id = nodes.size();
+        nodes.push_back(ForestNode());
+    }
+    ForestNode& node = nodes[id];
+    node.type = type;
+    node.var = var;
+    node.children = children;
+    node.references = 0;
+    for(int child: children){
+        nodes[child].references++;
+    }
+    unique.insert(std::make_pair(hash,id));
+    return id;
+}
+
+void DDNNFForest::release(int id){
+    std::vector<int> stack = std::vector<int>(1,id);
+    while(!stack.empty()){
+        int node_id = stack.back();
+        stack.pop_back();
+        ForestNode& node = nodes[node_id];
+        if(--node.references > 0){continue;}
+        auto range = unique.equal_range(node_hash(node.type,node.var,node.children));
+        for(auto item = range.first; item != range.second; item++){
+            if(item->second == node_id){
+                unique.erase(item);
+                break;
+            }
+        }
+        stack.insert(stack.end(),node.children.begin(),node.children.end());
+        // give the memory of the children back, the id is reused
+        std::vector<int>().swap(node.children);
+        free_ids.push_back(node_id);
+    }
+}
+
+std::vector<int> DDNNFForest::reachable(const std::vector<int>& from)const{
+    // iterative post-order, circuits can be deeper than the stack
+    std::vector<char> visited = std::vector<char>(nodes.size(),0);
+    std::vector<int> order = std::vector<int>();
+    std::vector<std::pair<int,size_t>> stack = std::vector<std::pair<int,size_t>>();
+    for(int start: from){
+        if(visited[start]){continue;}
+        visited[start] = 1;
+        stack.push_back(std::make_pair(start,0));
+        while(!stack.empty()){
+            int node_id = stack.back().first;
+            size_t next = stack.back().second;
+            const std::vector<int>& children = nodes[node_id].children;
+            if(next < children.size()){
+                stack.back().second++;
+                int child = children[next];
+                if(!visited[child]){
+                    visited[child] = 1;
+                    stack.push_back(std::make_pair(child,0));
+                }
+                continue;
+            }
+            order.push_back(node_id);
+            stack.pop_back();
+        }
+    }
+    return order;
+}
+
+void DDNNFForest::set_root(const std::string& name, int node, int total_variables){
+    // the new root is referenced first, so the nodes it shares with
+    // the circuit it replaces are not freed in between
+    nodes[node].references++;
+    auto item = roots.find(name);
+    if(item != roots.end()){
+        int old_node = item->second.node;
+        item->second.node = node;
+        item->second.total_variables = total_variables;
+        release(old_node);
+    }else{
+        ForestRoot root = ForestRoot();
+        root.node = node;
+        root.total_variables = total_variables;
+        roots[name] = root;
+    }
+    this->total_variables = std::max(this->total_variables,total_variables);
+}
+
+void DDNNFForest::add(const std::string& name, const DDNNF& ddnnf){
+    if(name.empty() || name[0] == '#' || name.find_first_of(" \t\r\n") != std::string::npos){
+        fail("Invalid circuit name \"" + name + "\"");
+    }
+    // node ids are children first, every child is interned before its parents
+    std::vector<int> copies = std::vector<int>(ddnnf.node_count(),-1);
+    for(int id = 0; id < (int)copies.size(); id++){
+        const DDNNFNode* node = ddnnf.get_node(id);
+        std::vector<int> children = std::vector<int>();
+        for(int child: node->get_children()){
+            children.push_back(copies[child]);
+        }
+        std::sort(children.begin(),children.end());
+        int var = node->is_literal() ? node->get_var() : node->get_decision_var();
+        copies[id] = intern(node->get_type(),var,children);
+    }
+    set_root(name,copies[ddnnf.get_root_id()],ddnnf.get_total_variables());
+}
+
+void DDNNFForest::remove(const std::string& name){
+    auto item = roots.find(name);
+    if(item == roots.end()){
+        fail("Unknown circuit " + name);
+    }
+    int node = item->second.node;
+    roots.erase(item);
+    release(node);
+}
+
+bool DDNNFForest::has(const std::string& name)const{
+    return roots.find(name) != roots.end();
+}
+
+DDNNF DDNNFForest::get(const std::string& name)const{
+    auto item = roots.find(name);
+    if(item == roots.end()){
+        fail("Unknown circuit " + name);
+    }
+    const ForestRoot& root = item->second;
+    DDNNF ddnnf = DDNNF();
+    ddnnf.total_variables = root.total_variables;
+    ddnnf.prepare_literals(root.total_variables);
+    std::vector<int> copies = std::vector<int>(nodes.size(),-1);
+    for(int id: reachable(std::vector<int>(1,root.node))){
+        const ForestNode& node = nodes[id];
+        int copy = ddnnf.add_node(node.type,node.type == DDNNF_LITERAL ? node.var : 0);
+        if(node.type == DDNNF_OR){
+            ddnnf.nodes.mut(copy)->set_decision_var(node.var);
+        }
+        for(int child: node.children){
+            ddnnf.add_edge(copy,copies[child]);
+        }
+        copies[id] = copy;
+    }
+    ddnnf.root_id = copies[root.node];
+    ddnnf.simplify();
+    return ddnnf;
+}
+
+void DDNNFForest::condition(const std::string& name, const std::set<int>& vars, int threads){
+    DDNNF ddnnf = get(name);
+    ddnnf.condition_all(vars,threads);
+    add(name,ddnnf);
+}
+
+std::vector<std::string> DDNNFForest::root_names()const{
+    std::vector<std::string> names = std::vector<std::string>();
+    for(auto& item: roots){
+        names.push_back(item.first);
+    }
+    return names;
+}
+
+long DDNNFForest::node_count()const{
+    return nodes.size() - free_ids.size();
+}
+
+long DDNNFForest::edge_count()const{
+    long total_edges = 0;
+    for(const ForestNode& node: nodes){
+        total_edges += node.children.size();
+    }
+    return total_edges;
+}
+
+int DDNNFForest::get_total_variables()const{
+    return total_variables;
+}
+
+void DDNNFForest::save(const char* filename)const{
+    std::ofstream out(filename);
+    if(!out){
+        fail(std::string("Unable to open file ") + filename);
+    }
+    save(out);
+    out.close();
+    if(out.fail()){
+        fail(std::string("Unable to write file ") + filename);
+    }
+}
+
+void DDNNFForest::save(std::ostream& out)const{
+    // every stored node is used by some root, ids are renumbered children first
+    std::vector<int> from = std::vector<int>();
+    for(auto& item: roots){
+        from.push_back(item.second.node);
+    }
+    std::vector<int> order = reachable(from);
+    std::vector<int> new_ids = std::vector<int>(nodes.size(),-1);
+    long total_edges = 0;
+    for(int i = 0; i < (int)order.size(); i++){
+        new_ids[order[i]] = i;
+        total_edges += nodes[order[i]].children.size();
+    }
+    out << "forest " << order.size() << " " << total_edges << " " << total_variables << " " << roots.size() << "\n";
+    for(int id: order){
+        const ForestNode& node = nodes[id];
+        switch(node.type){
+            case DDNNF_TRUE: out << "A 0\n"; break;
+            case DDNNF_FALSE: out << "O 0 0\n"; break;
+            case DDNNF_LITERAL: out << "L " << node.var << "\n"; break;
+            case DDNNF_AND:
+            case DDNNF_OR:{
+                out << (node.type == DDNNF_AND ? "A " : "O ");
+                if(node.type == DDNNF_OR){out << node.var << " ";}
+                out << node.children.size();
+                for(int child: node.children){
+                    out << " " << new_ids[child];
+                }
+                out << "\n";
+            }break;
+        }
+    }
+    for(auto& item: roots){
+        out << "R " << item.first << " " << item.second.total_variables << " " << new_ids[item.second.node] << "\n";
+    }
+}
+
+void DDNNFForest::load(const char* filename){
+    std::ifstream in(filename);
+    if(!in){
+        fail(std::string("Unable to open file ") + filename);
+    }
+    std::string header;
+    long node_total, edge_total, root_total;
+    int variables;
+    if(!(in >> header >> node_total >> edge_total >> variables >> root_total) || header != "forest" || node_total < 0 || root_total < 0 || variables < 0){
+        print_forest_error();
+    }
+    // file ids to forest ids, nodes already stored are reused
+    std::vector<int> ids = std::vector<int>();
+    std::vector<int> children = std::vector<int>();
+    for(long i = 0; i < node_total; i++){
+        std::string kind;
+        int var = 0;
+        long count = 0;
+        if(!(in >> kind)){print_forest_error();}
+        ddnnf_node_type type;
+        if(kind == "L"){
+            if(!(in >> var) || var == 0 || abs(var) > variables){print_forest_error();}
+            type = DDNNF_LITERAL;
+        }else if(kind == "A" || kind == "O"){
+            if((kind == "O" && !(in >> var)) || !(in >> count) || count < 0 || count > i){print_forest_error();}
+            type = kind == "A" ? DDNNF_AND : DDNNF_OR;
+        }else{
+            print_forest_error();
+        }
+        children.clear();
+        for(long c = 0; c < count; c++){
+            long child;
+            if(!(in >> child) || child < 0 || child >= i){print_forest_error();}
+            children.push_back(ids[child]);
+        }
+        if(count == 0 && type != DDNNF_LITERAL){
+            // as in the nnf formats, "A 0" is true and "O 0 0" false
+            type = type == DDNNF_AND ? DDNNF_TRUE : DDNNF_FALSE;
+            var = 0;
+        }
+        std::sort(children.begin(),children.end());
+        children.erase(std::unique(children.begin(),children.end()),children.end());
+        ids.push_back(intern(type,var,children));
+    }
+    for(long r = 0; r < root_total; r++){
+        std::string kind, name;
+        int root_variables;
+        long node;
+        if(!(in >> kind >> name >> root_variables >> node) || kind != "R" || name[0] == '#' || root_variables < 0 || node < 0 || node >= node_total){
+            print_forest_error();
+        }
+        set_root(name,ids[node],root_variables);
+    }
+    // nodes no root uses are not kept
+    std::vector<int> unused = std::vector<int>();
+    for(int id: ids){
+        if(nodes[id].references == 0){unused.push_back(id);}
+    }
+    std::sort(unused.begin(),unused.end());
+    unused.erase(std::unique(unused.begin(),unused.end()),unused.end());
+    for(int id: unused){
+        nodes[id].references++;
+        release(id);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef __FOREST_H__
+#define __FOREST_H__
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+#include "ddnnf.h"
+
+// node of a forest, children are sorted ids of other forest nodes
+struct ForestNode{
+    ddnnf_node_type type;
+    int var; // literal of LITERAL nodes, decision variable of OR nodes
+    std::vector<int> children;
+    int references; // parents in the forest plus roots, 0 for free ids
+};
+
+// circuit of the forest, named by its root
+struct ForestRoot{
+    int node;
+    int total_variables;
+};
+
+// Named circuits over one node store. Structurally equal nodes (same
+// type, variable and children) are stored once, so literals and common
+// sub-circuits are shared by every circuit using them and memory grows
+// with the distinct structure only. Every node counts the references
+// from its parents and from the roots, and is freed with the nodes only
+// it used once the count drops to zero. Circuits are copied in and out
+// of the forest as DDNNF objects, so a circuit changed through one root
+// never changes the others.
+class DDNNFForest{
+    private:
+    std::vector<ForestNode> nodes;
+    std::vector<int> free_ids;
+    // node ids by hash of their structure
+    std::unordered_multimap<uint64_t,int> unique;
+    std::map<std::string,ForestRoot> roots;
+    int total_variables; // largest of the roots
+
+    static uint64_t node_hash(ddnnf_node_type type, int var, const std::vector<int>& children);
+    // id of the node, created with one reference to each child if needed;
+    // the caller takes a reference
+    int intern(ddnnf_node_type type, int var, const std::vector<int>& children);
+    void release(int id);
+    // ids reachable from the roots (or one node), children first
+    std::vector<int> reachable(const std::vector<int>& from)const;
+    void set_root(const std::string& name, int node, int total_variables);
+
+    public:
+    DDNNFForest();
+    // adds the circuit under name, replacing the circuit already named so
+    // that its nodes are freed unless other roots use them; names are
+    // single words not starting with #, which marks comments in lists
+    void add(const std::string& name, const DDNNF& ddnnf);
+    void remove(const std::string& name);
+    bool has(const std::string& name)const;
+    // simplified copy of the circuit named name
+    DDNNF get(const std::string& name)const;
+    // conditions the circuit named name, the other roots keep the nodes
+    // they share with it
+    void condition(const std::string& name, const std::set<int>& vars, int threads);
+    std::vector<std::string> root_names()const;
+    // distinct nodes and edges stored, shared ones are counted once
+    long node_count()const;
+    long edge_count()const;
+    int get_total_variables()const;
+    // "forest <nodes> <edges> <variables> <roots>", library nnf node lines
+    // with each node once and children first, then one
+    // "R <name> <variables> <node>" line per root; exits if the file
+    // cannot be read or written
+    void save(const char* filename)const;
+    void save(std::ostream& out)const;
+    // adds the roots of a saved forest
+    void load(const char* filename);
+};
+
+#endif
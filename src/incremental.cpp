@@ -0,0 +1,174 @@
+#include "incremental.h"
+#include "modular.h"
+#include "error.h"
+
+IncrementalEvaluator::IncrementalEvaluator(const DDNNF& ddnnf, const std::vector<uint64_t>& weights, uint64_t prime){
+    this->prime = prime;
+    total_variables = ddnnf.get_total_variables();
+    root = ddnnf.get_root_id();
+    if(weights.size() <= (size_t)total_variables){
+        fail("Missing weight for variable " + std::to_string(std::max((size_t)1,weights.size())));
+    }
+    this->weights = std::vector<uint64_t>(total_variables + 1,0);
+    for(int var = 1; var <= total_variables; var++){
+        this->weights[var] = weights[var] % prime;
+    }
+    evidence = std::vector<int>(total_variables + 1,0);
+    evidence_product = 1 % prime;
+    evidence_zeros = 0;
+    recomputed = 0;
+
+    int node_count = ddnnf.node_count();
+    types = std::vector<ddnnf_node_type>(node_count);
+    vars = std::vector<int>(node_count,0);
+    first_child = std::vector<int>(node_count + 1,0);
+    first_parent = std::vector<int>(node_count + 1,0);
+    literal_nodes = std::vector<int>(2 * total_variables + 1,-1);
+    for(int id = 0; id < node_count; id++){
+        const DDNNFNode* node = ddnnf.get_node(id);
+        types[id] = node->get_type();
+        if(node->is_literal()){
+            vars[id] = node->get_var();
+            literal_nodes[node->get_var() + total_variables] = id;
+        }
+        children.insert(children.end(),node->get_children().begin(),node->get_children().end());
+        parents.insert(parents.end(),node->get_parents().begin(),node->get_parents().end());
+        first_child[id + 1] = children.size();
+        first_parent[id + 1] = parents.size();
+    }
+    queued = std::vector<char>(node_count,0);
+    // children come first, one pass evaluates everything
+    values = std::vector<uint64_t>(node_count,0);
+    for(int id = 0; id < node_count; id++){
+        values[id] = node_value(id);
+    }
+}
+
+uint64_t IncrementalEvaluator::literal_weight(int literal)const{
+    uint64_t weight = weights[abs(literal)];
+    return literal > 0 ? weight : mod_sub(1 % prime,weight,prime);
+}
+
+uint64_t IncrementalEvaluator::literal_value(int literal)const{
+    int fixed = evidence[abs(literal)];
+    if(fixed == 0){return literal_weight(literal);}
+    return fixed == literal ? 1 % prime : 0;
+}
+
+uint64_t IncrementalEvaluator::node_value(int id)const{
+    switch(types[id]){
+        case DDNNF_TRUE: return 1 % prime;
+        case DDNNF_FALSE: return 0;
+        case DDNNF_LITERAL: return literal_value(vars[id]);
+        case DDNNF_AND:{
+            uint64_t product = 1 % prime;
+            for(int i = first_child[id]; i < first_child[id + 1] && product != 0; i++){
+                product = mod_mul(product,values[children[i]],prime);
+            }
+            return product;
+        }
+        case DDNNF_OR:{
+            uint64_t sum = 0;
+            for(int i = first_child[id]; i < first_child[id + 1]; i++){
+                sum = mod_add(sum,values[children[i]],prime);
+            }
+            return sum;
+        }
+    }
+    return 0;
+}
+
+void IncrementalEvaluator::multiply_evidence(int literal, bool inverse){
+    uint64_t weight = literal_weight(literal);
+    if(weight == 0){
+        evidence_zeros += inverse ? -1 : 1;
+        return;
+    }
+    evidence_product = mod_mul(evidence_product,inverse ? mod_inv(weight,prime) : weight,prime);
+}
+
+void IncrementalEvaluator::touch_variable(int var){
+    // the literal nodes are recomputed with the rest, in id order
+    for(int literal: {var,-var}){
+        int id = literal_nodes[literal + total_variables];
+        if(id >= 0 && !queued[id]){
+            queued[id] = 1;
+            pending.push(id);
+        }
+    }
+}
+
+void IncrementalEvaluator::propagate(){
+    while(!pending.empty()){
+        int id = pending.top();
+        pending.pop();
+        queued[id] = 0;
+        recomputed++;
+        uint64_t value = node_value(id);
+        // parents of an unchanged node keep their values
+        if(value == values[id]){continue;}
+        values[id] = value;
+        for(int i = first_parent[id]; i < first_parent[id + 1]; i++){
+            int parent = parents[i];
+            if(!queued[parent]){
+                queued[parent] = 1;
+                pending.push(parent);
+            }
+        }
+    }
+}
+
+void IncrementalEvaluator::set_weight(int var, uint64_t weight){
+    if(var <= 0 || var > total_variables){
+        fail("Invalid variable " + std::to_string(var));
+    }
+    weight %= prime;
+    if(weight == weights[var]){return;}
+    if(evidence[var] != 0){
+        // only the factor of the evidence literal changes
+        multiply_evidence(evidence[var],true);
+        weights[var] = weight;
+        multiply_evidence(evidence[var],false);
+        return;
+    }
+    weights[var] = weight;
+    touch_variable(var);
+}
+
+void IncrementalEvaluator::set_evidence(int literal){
+    // same checks as DDNNF::condition
+    if(literal == 0){
+        fail("Cannot condition on 0");
+    }
+    if(abs(literal) > total_variables){
+        fail("Invalid literal to condition");
+    }
+    int var = abs(literal);
+    if(evidence[var] == literal){return;}
+    if(evidence[var] != 0){
+        multiply_evidence(evidence[var],true);
+    }
+    evidence[var] = literal;
+    multiply_evidence(literal,false);
+    touch_variable(var);
+}
+
+void IncrementalEvaluator::clear_evidence(int var){
+    if(var <= 0 || var > total_variables){
+        fail("Invalid variable " + std::to_string(var));
+    }
+    if(evidence[var] == 0){return;}
+    multiply_evidence(evidence[var],true);
+    evidence[var] = 0;
+    touch_variable(var);
+}
+
+uint64_t IncrementalEvaluator::value(){
+    propagate();
+    if(evidence_zeros > 0 || root < 0){return 0;}
+    return mod_mul(values[root],evidence_product,prime);
+}
+
+long IncrementalEvaluator::recomputed_nodes()const{
+    return recomputed;
+}
@@ -0,0 +1,64 @@
+#ifndef __INCREMENTAL_H__
+#define __INCREMENTAL_H__
+
+#include <vector>
+#include <set>
+#include <queue>
+#include <cstdint>
+#include "ddnnf.h"
+
+// Weighted model count modulo a prime kept up to date while weights and
+// evidence change a few variables at a time. Every node caches its value;
+// a change recomputes the parents of the touched literals and goes up
+// only while values change, so an update costs the edges of the nodes
+// it actually affects. Node ids are children first, so recomputing in
+// increasing id order sees every child before its parents.
+class IncrementalEvaluator{
+    private:
+    uint64_t prime;
+    int total_variables;
+    int root;
+    // circuit in flat arrays, children and parents of node i are
+    // [first_child[i], first_child[i + 1]) and the same for parents
+    std::vector<ddnnf_node_type> types;
+    std::vector<int> vars; // literal of LITERAL nodes
+    std::vector<int> first_child;
+    std::vector<int> children;
+    std::vector<int> first_parent;
+    std::vector<int> parents;
+    std::vector<int> literal_nodes; // node of literal l at l + total_variables, -1 if none
+    std::vector<uint64_t> values;
+    // weights[v] is the weight of v, -v gets 1 - weights[v]
+    std::vector<uint64_t> weights;
+    std::vector<int> evidence; // literal fixed for each variable, 0 if free
+    // as in DDNNF::condition, evidence literals become constants and the
+    // result is multiplied by their weights: the product of the nonzero
+    // ones, kept up to date with inverses, and the number of zeros
+    uint64_t evidence_product;
+    int evidence_zeros;
+    std::priority_queue<int,std::vector<int>,std::greater<int>> pending;
+    std::vector<char> queued;
+    long recomputed;
+
+    uint64_t literal_weight(int literal)const;
+    uint64_t literal_value(int literal)const;
+    void multiply_evidence(int literal, bool inverse);
+    uint64_t node_value(int id)const;
+    void touch_variable(int var);
+    void propagate();
+
+    public:
+    // weights as for DDNNF::weighted_count_mod, one per variable
+    IncrementalEvaluator(const DDNNF& ddnnf, const std::vector<uint64_t>& weights, uint64_t prime);
+    void set_weight(int var, uint64_t weight);
+    // fixes the variable of literal to its sign, as DDNNF::condition
+    void set_evidence(int literal);
+    void clear_evidence(int var);
+    // weighted count of the models agreeing with the evidence, the
+    // weighted count of the circuit conditioned on it
+    uint64_t value();
+    // nodes recomputed by the changes since the evaluator was built
+    long recomputed_nodes()const;
+};
+
+#endif
@@ -1,68 +1,663 @@
 #include "ddnnf.h"
 #include "args.h"
+#include "stream.h"
+#include "binary.h"
+#include "outofcore.h"
+#include "stats.h"
+#include "tape.h"
+#include "incremental.h"
+#include "cache.h"
+#include "forest.h"
+#include "modular.h"
 
 // timing operations
 #include <chrono>
+// peak memory and allocation counts
+#include <sys/resource.h>
+#include <atomic>
+#include <new>
+#include <climits>
 
-int main(int argc, char** argv) {
-    // init objects
-    DDNNFArgs args = DDNNFArgs(argc, argv);
-    DDNNF ddnnf = DDNNF();
+// allocations are only counted in builds made with
+// "make COUNT_ALLOCATIONS=1", other builds keep the default
+// operators and report -1 allocations
+#ifdef DDNNF_COUNT_ALLOCATIONS
+std::atomic<long> allocation_count(0);
 
-    // read input
-    auto start_time = std::chrono::high_resolution_clock::now();
-    std::string input_file = args.get_input_file();
-    ddnnf_file_format input_format = args.get_input_format();
+void* counted_allocation(size_t size) noexcept{
+    allocation_count.fetch_add(1,std::memory_order_relaxed);
+    return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(size_t size){
+    void* memory = counted_allocation(size);
+    if(memory == nullptr){throw std::bad_alloc();}
+    return memory;
+}
+
+void* operator new[](size_t size){
+    void* memory = counted_allocation(size);
+    if(memory == nullptr){throw std::bad_alloc();}
+    return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept{
+    return counted_allocation(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept{
+    return counted_allocation(size);
+}
+
+void operator delete(void* memory) noexcept{
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept{
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept{
+    free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept{
+    free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept{
+    free(memory);
+}
+
+long allocations_made(){
+    return allocation_count.load();
+}
+#else
+long allocations_made(){
+    return -1;
+}
+#endif
+
+void read_input(DDNNF& ddnnf, const std::string& input_file, ddnnf_file_format input_format, int threads, bool pipeline){
+    if(input_format == ddnnf_file_format::BINARY_FILE_TYPE){
+        // binary files are mapped, there is nothing to pipeline
+        ddnnf.read_binary_file(input_file.c_str());
+        return;
+    }
+    if(pipeline){
+        // a reader thread streams the file while this thread builds the nodes
+        InputFile infile(input_file,true);
+        switch(input_format){
+            case ddnnf_file_format::DDNNF_FILE_TYPE: ddnnf.read_ddnnf_stream(infile.stream()); break;
+            case ddnnf_file_format::C2D_FILE_TYPE: ddnnf.read_c2d_stream(infile.stream()); break;
+            case ddnnf_file_format::D4_FILE_TYPE: ddnnf.read_d4_stream(infile.stream()); break;
+            default:
+                std::cerr << "Error: Invalid input format" << std::endl;
+                exit(1);
+        }
+        return;
+    }
     switch(input_format){
         case ddnnf_file_format::DDNNF_FILE_TYPE:
-            ddnnf.read_ddnnf_file(input_file.c_str());
+            ddnnf.read_ddnnf_file(input_file.c_str(),threads);
             break;
         case ddnnf_file_format::C2D_FILE_TYPE:
-            ddnnf.read_c2d_file(input_file.c_str());
+            ddnnf.read_c2d_file(input_file.c_str(),threads);
             break;
         case ddnnf_file_format::D4_FILE_TYPE:
-            ddnnf.read_d4_file(input_file.c_str());
+            ddnnf.read_d4_file(input_file.c_str(),threads);
             break;
         default:
             std::cerr << "Error: Invalid input format" << std::endl;
             exit(1);
     }
+}
+
+void write_output(const DDNNF& ddnnf, const std::string& output_file, ddnnf_file_format output_format, compression_format compression, bool pipeline){
+    // with -pipeline this thread formats the nodes while a writer thread flushes full blocks
+    OutputFile outfile(output_file,compression,pipeline);
+    switch(output_format){
+        case ddnnf_file_format::DDNNF_FILE_TYPE: ddnnf.serialize(outfile.stream()); break;
+        case ddnnf_file_format::C2D_FILE_TYPE: ddnnf.serialize_c2d(outfile.stream()); break;
+        case ddnnf_file_format::D4_FILE_TYPE: ddnnf.serialize_d4(outfile.stream()); break;
+        default: break;
+    }
+    outfile.close();
+}
+
+// temporary binary copy of a text input, removed even when exiting on errors
+std::string converted_input_file;
+
+void remove_converted_input(){
+    if(!converted_input_file.empty()){
+        remove(converted_input_file.c_str());
+    }
+}
+
+void write_stats(const DDNNFArgs& args, const DDNNFStats& stats){
+    if(!args.has_stats_file()){return;}
+    struct rusage usage;
+    getrusage(RUSAGE_SELF,&usage);
+    std::ofstream out(args.get_stats_file());
+    // ru_maxrss is in KB on Linux
+    stats.write_json(out,usage.ru_maxrss,allocations_made());
+    out.close();
+    if(out.fail()){
+        std::cerr << "Error: Unable to write file " << args.get_stats_file() << std::endl;
+        exit(1);
+    }
+}
+
+int run_out_of_core(const DDNNFArgs& args){
+    // the circuit is only ever scanned from disk, text input is first
+    // converted to a temporary binary file
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::string input_file = args.get_input_file();
+    bool converted = args.get_input_format() != ddnnf_file_format::BINARY_FILE_TYPE;
+    if(converted){
+        input_file = temporary_file_name();
+        converted_input_file = input_file;
+        atexit(remove_converted_input);
+        convert_to_binary(args.get_input_file().c_str(),input_file.c_str(),args.get_input_format() == ddnnf_file_format::C2D_FILE_TYPE);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Converted input to binary in " << duration.count() << " ms" << std::endl;
+        start_time = end_time;
+    }
+    condition_out_of_core(input_file.c_str(),args.get_output_file().c_str(),args.get_conditions(),args.get_out_of_core_budget());
     auto end_time = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    std::cout << "Read input in " << duration.count() << " ms" << std::endl;
+    std::cerr << "Performed out-of-core conditioning in " << duration.count() << " ms" << std::endl;
+    return 0;
+}
 
-    // perform conditioning if needed
-    start_time = std::chrono::high_resolution_clock::now();
+std::vector<std::vector<int>> read_literal_lines(const std::string& filename){
+    // one clause or term per line, DIMACS style:
+    // literals are terminated by 0, lines starting with c or p are skipped
+    std::ifstream infile(filename);
+    if(!infile){
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        exit(1);
+    }
+    std::vector<std::vector<int>> lines = std::vector<std::vector<int>>();
+    std::string line;
+    while(std::getline(infile,line)){
+        std::istringstream iss(line);
+        std::string token;
+        if(!(iss >> token)){continue;}
+        if(token == "c" || token == "p"){continue;}
+        std::vector<int> literals = std::vector<int>();
+        do{
+            int literal;
+            try{
+                literal = std::stoi(token);
+            }catch(std::invalid_argument& e){
+                std::cerr << "Error: Invalid literal " << token << " in " << filename << std::endl;
+                exit(1);
+            }
+            if(literal == 0){break;}
+            literals.push_back(literal);
+        }while(iss >> token);
+        lines.push_back(literals);
+    }
+    infile.close();
+    return lines;
+}
+
+long replay_updates(const DDNNF& ddnnf, const std::string& filename, std::ostream& results, long& updates){
+    // one update per line: "w <var> <weight>", "e <literal>", "r <var>",
+    // or "q" to print the current value; lines starting with c are skipped
+    std::ifstream infile(filename);
+    if(!infile){
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        exit(1);
+    }
+    uint64_t prime = find_primes(1)[0];
+    std::vector<uint64_t> weights = std::vector<uint64_t>(ddnnf.get_total_variables() + 1,mod_inv(2,prime));
+    IncrementalEvaluator evaluator(ddnnf,weights,prime);
+    std::string line;
+    while(std::getline(infile,line)){
+        std::istringstream iss(line);
+        std::string kind;
+        if(!(iss >> kind) || kind == "c"){continue;}
+        long long first = 0;
+        unsigned long long weight = 0;
+        if(kind == "q"){
+            results << evaluator.value() << "\n";
+            continue;
+        }
+        if(!(iss >> first) || (kind == "w" && !(iss >> weight)) || (kind != "w" && kind != "e" && kind != "r") || first < INT_MIN || first > INT_MAX){
+            std::cerr << "Error: Invalid update " << line << " in " << filename << std::endl;
+            exit(1);
+        }
+        if(kind == "w"){evaluator.set_weight(first,weight);}
+        if(kind == "e"){evaluator.set_evidence(first);}
+        if(kind == "r"){evaluator.clear_evidence(first);}
+        updates++;
+    }
+    return evaluator.recomputed_nodes();
+}
+
+// model count, entailment and consistency queries, answered the same
+// way by circuits and evaluation tapes
+template<typename Circuit>
+void answer_queries(const Circuit& circuit, const DDNNFArgs& args, std::ostream& results, DDNNFStats& stats){
+    // compute model count if needed
+    if(args.has_model_count()){
+        auto start_time = std::chrono::high_resolution_clock::now();
+        BigInt count = circuit.model_count(args.get_model_count_bits(),args.get_threads());
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        results << "Model count: " << count.to_string() << std::endl;
+        std::cerr << "Computed model count in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("model_count",duration.count());
+    }
+
+    // answer batch entailment and consistency queries if needed
+    if(args.has_entailment_file()){
+        auto start_time = std::chrono::high_resolution_clock::now();
+        std::vector<bool> entailed = circuit.are_entailed(read_literal_lines(args.get_entailment_file()),args.get_threads());
+        for(bool result: entailed){
+            results << (result ? 1 : 0) << "\n";
+        }
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Checked " << entailed.size() << " clauses in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("entailment",duration.count());
+    }
+    if(args.has_consistency_file()){
+        auto start_time = std::chrono::high_resolution_clock::now();
+        std::vector<bool> consistent = circuit.are_consistent(read_literal_lines(args.get_consistency_file()),args.get_threads());
+        for(bool result: consistent){
+            results << (result ? 1 : 0) << "\n";
+        }
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Checked " << consistent.size() << " terms in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("consistency",duration.count());
+    }
+}
+
+void write_cardinality(const std::vector<BigInt>& counts, const std::string& filename){
+    // "-" prints the histogram to standard output
+    std::ofstream file;
+    if(!is_standard_stream(filename)){
+        file.open(filename);
+    }
+    std::ostream& out = is_standard_stream(filename) ? std::cout : file;
+    for(size_t k = 0; k < counts.size(); k++){
+        out << k << " " << counts[k].to_string() << "\n";
+    }
+    out.flush();
+    if(file.is_open()){
+        file.close();
+    }
+    if(out.fail()){
+        std::cerr << "Error: Unable to write file " << filename << std::endl;
+        exit(1);
+    }
+}
+
+void write_cpp(const EvaluationTape& tape, const std::string& filename){
+    std::ofstream out(filename);
+    tape.write_cpp(out);
+    out.close();
+    if(out.fail()){
+        std::cerr << "Error: Unable to write file " << filename << std::endl;
+        exit(1);
+    }
+}
+
+int run_tape(const DDNNFArgs& args){
+    // tapes are evaluated as they are, without building the circuit
+    DDNNFStats stats = DDNNFStats();
+    auto start_time = std::chrono::high_resolution_clock::now();
+    EvaluationTape tape = EvaluationTape();
+    tape.load(args.get_input_file().c_str());
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cerr << "Read evaluation tape in " << duration.count() << " ms" << std::endl;
+    stats.add_phase("read",duration.count());
+    answer_queries(tape,args,std::cout,stats);
+    if(args.has_cpp_file()){
+        write_cpp(tape,args.get_cpp_file());
+    }
+    write_stats(args,stats);
+    return 0;
+}
+
+void read_forest(DDNNFForest& forest, const std::string& filename, int threads, long& circuit_nodes){
+    // a saved forest, or one "<name> <format> <file>" line per circuit,
+    // lines starting with # are skipped: c is a valid circuit name
+    std::ifstream infile(filename);
+    if(!infile){
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        exit(1);
+    }
+    std::string first;
+    if(infile >> first && first == "forest"){
+        infile.close();
+        forest.load(filename.c_str());
+        return;
+    }
+    infile.clear();
+    infile.seekg(0);
+    std::string line;
+    while(std::getline(infile,line)){
+        std::istringstream iss(line);
+        std::string name, format, file;
+        if(!(iss >> name) || name[0] == '#'){continue;}
+        if(!(iss >> format >> file)){
+            std::cerr << "Error: Invalid circuit " << line << " in " << filename << std::endl;
+            exit(1);
+        }
+        ddnnf_file_format input_format = ddnnf_file_format::NONE_TYPE;
+        if(format == "nnf"){input_format = ddnnf_file_format::DDNNF_FILE_TYPE;}
+        if(format == "c2d"){input_format = ddnnf_file_format::C2D_FILE_TYPE;}
+        if(format == "d4"){input_format = ddnnf_file_format::D4_FILE_TYPE;}
+        if(format == "bin"){input_format = ddnnf_file_format::BINARY_FILE_TYPE;}
+        if(input_format == ddnnf_file_format::NONE_TYPE){
+            std::cerr << "Error: Invalid format " << format << " in " << filename << std::endl;
+            exit(1);
+        }
+        // each circuit is freed once its new nodes are in the forest
+        DDNNF ddnnf = DDNNF();
+        read_input(ddnnf,file,input_format,threads,false);
+        circuit_nodes += ddnnf.node_count();
+        forest.add(name,ddnnf);
+    }
+}
+
+int run_forest(const DDNNFArgs& args){
+    DDNNFStats stats = DDNNFStats();
+    std::ostream& results = is_standard_stream(args.get_output_file()) ? std::cerr : std::cout;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    DDNNFForest forest = DDNNFForest();
+    long circuit_nodes = 0;
+    read_forest(forest,args.get_input_file(),args.get_threads(),circuit_nodes);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cerr << "Read forest of " << forest.root_names().size() << " circuits (" << forest.node_count() << " nodes";
+    if(circuit_nodes > 0){
+        std::cerr << " for " << circuit_nodes << " circuit nodes";
+    }
+    std::cerr << ") in " << duration.count() << " ms" << std::endl;
+    stats.add_phase("read",duration.count());
+
+    std::vector<std::string> names = forest.root_names();
+    if(args.has_forest_root()){
+        if(!forest.has(args.get_forest_root())){
+            std::cerr << "Error: Unknown circuit " << args.get_forest_root() << std::endl;
+            exit(1);
+        }
+        names = std::vector<std::string>(1,args.get_forest_root());
+    }
+
+    // condition every circuit if needed
     std::set<int> conditions = args.get_conditions();
     if(conditions.size() > 0){
-        ddnnf.condition_all(conditions);
+        start_time = std::chrono::high_resolution_clock::now();
+        for(const std::string& name: names){
+            forest.condition(name,conditions,args.get_threads());
+        }
         end_time = std::chrono::high_resolution_clock::now();
         duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-        std::cout << "Performed conditioning in " << duration.count() << " ms" << std::endl;
+        std::cerr << "Performed conditioning in " << duration.count() << " ms, " << forest.node_count() << " nodes" << std::endl;
+        stats.add_phase("condition",duration.count());
+    }
+
+    // model count of every circuit if needed
+    if(args.has_model_count()){
+        start_time = std::chrono::high_resolution_clock::now();
+        for(const std::string& name: names){
+            BigInt count = forest.get(name).model_count(args.get_model_count_bits(),args.get_threads());
+            results << "Model count " << name << ": " << count.to_string() << std::endl;
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Computed model counts in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("model_count",duration.count());
+    }
+
+    // write the forest, or the selected circuit, if needed
+    if(args.has_output_file()){
+        start_time = std::chrono::high_resolution_clock::now();
+        if(!args.has_forest_root() && is_standard_stream(args.get_output_file())){
+            forest.save(std::cout);
+        }else if(!args.has_forest_root()){
+            forest.save(args.get_output_file().c_str());
+        }else if(args.get_output_format() == ddnnf_file_format::BINARY_FILE_TYPE){
+            forest.get(args.get_forest_root()).serialize_binary(args.get_output_file().c_str());
+        }else{
+            compression_format compression = compression_from_extension(args.get_output_file());
+            if(args.has_output_compression()){
+                compression = compression_from_name(args.get_output_compression());
+            }
+            write_output(forest.get(args.get_forest_root()),args.get_output_file(),args.get_output_format(),compression,args.has_pipeline());
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Saved output in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("write",duration.count());
+    }
+    write_stats(args,stats);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // init objects
+    DDNNFArgs args = DDNNFArgs(argc, argv);
+    if(args.has_out_of_core()){
+        return run_out_of_core(args);
+    }
+    if(args.get_input_format() == ddnnf_file_format::TAPE_FILE_TYPE){
+        return run_tape(args);
+    }
+    if(args.get_input_format() == ddnnf_file_format::FOREST_FILE_TYPE){
+        return run_forest(args);
+    }
+    DDNNF ddnnf = DDNNF();
+    DDNNFStats stats = DDNNFStats();
+    if(args.has_stats_file()){
+        ddnnf.set_stats(&stats);
+    }
+    int exit_code = 0;
+    // timings always go to stderr, query results too when
+    // the circuit is written to stdout
+    std::ostream& results = is_standard_stream(args.get_output_file()) ? std::cerr : std::cout;
+
+    // look the conditioned circuit up in the cache if needed
+    auto start_time = std::chrono::high_resolution_clock::now();
+    auto end_time = start_time;
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::unique_ptr<ResultCache> cache;
+    std::string cache_key;
+    bool cache_hit = false;
+    if(args.has_cache()){
+        cache.reset(new ResultCache(args.get_cache_directory(),args.get_cache_size()));
+        cache_key = cache->key(args.get_input_file(),args.get_input_format(),args.get_conditions());
+        cache_hit = cache->load(cache_key,ddnnf);
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << (cache_hit ? "Loaded circuit from cache in " : "Looked up cache in ") << duration.count() << " ms" << std::endl;
+        stats.add_phase("cache_lookup",duration.count());
+    }
+
+    if(!cache_hit){
+        // read input
+        start_time = std::chrono::high_resolution_clock::now();
+        read_input(ddnnf,args.get_input_file(),args.get_input_format(),args.get_threads(),args.has_pipeline());
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Read input in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("read",duration.count());
+
+        // conjoin the circuits over other variables if needed
+        if(args.has_conjunction()){
+            start_time = std::chrono::high_resolution_clock::now();
+            std::vector<std::string> files = args.get_conjunction_files();
+            std::vector<ddnnf_file_format> formats = args.get_conjunction_formats();
+            std::vector<DDNNF> others = std::vector<DDNNF>(files.size());
+            for(size_t i = 0; i < files.size(); i++){
+                read_input(others[i],files[i],formats[i],args.get_threads(),args.has_pipeline());
+            }
+            ddnnf.conjoin(others,args.has_conjunction_offset());
+            end_time = std::chrono::high_resolution_clock::now();
+            duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+            std::cerr << "Conjoined " << files.size() + 1 << " circuits (" << ddnnf.get_total_variables() << " variables) in " << duration.count() << " ms" << std::endl;
+            stats.add_phase("conjoin",duration.count());
+        }
+
+        // perform conditioning if needed
+        start_time = std::chrono::high_resolution_clock::now();
+        std::set<int> conditions = args.get_conditions();
+        if(conditions.size() > 0){
+            ddnnf.condition_all(conditions,args.get_threads());
+            end_time = std::chrono::high_resolution_clock::now();
+            duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+            std::cerr << "Performed conditioning in " << duration.count() << " ms" << std::endl;
+            stats.add_phase("condition",duration.count());
+        }
+
+        // save the conditioned circuit to the cache if needed
+        if(cache){
+            start_time = std::chrono::high_resolution_clock::now();
+            cache->store(cache_key,ddnnf);
+            end_time = std::chrono::high_resolution_clock::now();
+            duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+            std::cerr << "Saved circuit to cache in " << duration.count() << " ms" << std::endl;
+            stats.add_phase("cache_store",duration.count());
+        }
+    }
+
+    // smooth formula if needed
+    if(args.has_smooth()){
+        start_time = std::chrono::high_resolution_clock::now();
+        ddnnf.smooth();
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Smoothed formula in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("smooth",duration.count());
+    }
+
+    // renumber nodes for locality if needed
+    if(args.has_reorder()){
+        start_time = std::chrono::high_resolution_clock::now();
+        double span_before = ddnnf.average_edge_span();
+        node_order order = ddnnf.reorder(node_order_from_name(args.get_reorder()));
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Reordered nodes (" << node_order_name(order) << ") in " << duration.count() << " ms, average edge span " << span_before << " -> " << ddnnf.average_edge_span() << std::endl;
+        stats.add_phase("reorder",duration.count());
+    }
+
+    // save the evaluation tape and the generated evaluator if needed
+    if(args.has_tape_file() || args.has_cpp_file()){
+        start_time = std::chrono::high_resolution_clock::now();
+        EvaluationTape tape(ddnnf);
+        if(args.has_tape_file()){
+            tape.save(args.get_tape_file().c_str());
+        }
+        if(args.has_cpp_file()){
+            write_cpp(tape,args.get_cpp_file());
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Saved evaluation tape (" << tape.instruction_count() << " instructions) in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("tape",duration.count());
+    }
+
+    answer_queries(ddnnf,args,results,stats);
+
+    // replay weight and evidence updates if needed
+    if(args.has_update_file()){
+        start_time = std::chrono::high_resolution_clock::now();
+        long updates = 0;
+        long recomputed = replay_updates(ddnnf,args.get_update_file(),results,updates);
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Applied " << updates << " updates (" << recomputed << " nodes recomputed) in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("updates",duration.count());
+    }
+
+    // compute cardinality histogram if needed
+    if(args.has_cardinality_file()){
+        start_time = std::chrono::high_resolution_clock::now();
+        std::vector<BigInt> counts = ddnnf.cardinality_counts(args.get_threads());
+        write_cardinality(counts,args.get_cardinality_file());
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Computed cardinality histogram in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("cardinality",duration.count());
+    }
+
+    // check equivalence with a second circuit if needed
+    if(args.has_equivalence_file()){
+        start_time = std::chrono::high_resolution_clock::now();
+        DDNNF other = DDNNF();
+        read_input(other,args.get_equivalence_file(),args.get_equivalence_format(),args.get_threads(),args.has_pipeline());
+        double error_exponent;
+        if(ddnnf.is_equivalent(other,args.get_equivalence_trials(),args.get_threads(),error_exponent)){
+            results << "Equivalent with error probability <= 1e" << (int)std::floor(error_exponent) + 1 << std::endl;
+        }else{
+            results << "Not equivalent" << std::endl;
+            // signal the failure to scripts, but still write the output
+            exit_code = 2;
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Checked equivalence in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("equivalence",duration.count());
+    }
+
+    // compact variables if needed, after the queries so that
+    // they still refer to the original variables
+    if(args.has_variable_map_file()){
+        start_time = std::chrono::high_resolution_clock::now();
+        ddnnf.compact_variables();
+        std::ofstream out(args.get_variable_map_file());
+        for(int var = 1; var <= ddnnf.get_total_variables(); var++){
+            out << var << " " << ddnnf.original_literal(var) << "\n";
+        }
+        out.close();
+        if(out.fail()){
+            std::cerr << "Error: Unable to write file " << args.get_variable_map_file() << std::endl;
+            exit(1);
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cerr << "Compacted variables to " << ddnnf.get_total_variables() << " in " << duration.count() << " ms" << std::endl;
+        stats.add_phase("compact",duration.count());
     }
 
     // write output
     start_time = std::chrono::high_resolution_clock::now();
-    std::string output_file = args.get_output_file();
-    ddnnf_file_format output_format = args.get_output_format();
-    switch(output_format){
-        case ddnnf_file_format::DDNNF_FILE_TYPE:
-            ddnnf.serialize(output_file.c_str());
-            break;
-        case ddnnf_file_format::C2D_FILE_TYPE:
-            ddnnf.serialize_c2d(output_file.c_str());
-            break;
-        case ddnnf_file_format::D4_FILE_TYPE:
-            ddnnf.serialize_d4(output_file.c_str());
-            break;
-        default:
-            // do nothing, no output file specified
-            return 0;
+    if(args.get_output_format() == ddnnf_file_format::NONE_TYPE){
+        // do nothing, no output file specified
+        write_stats(args,stats);
+        return exit_code;
+    }
+    // the compression is taken from the file extension unless given explicitly
+    compression_format compression = compression_from_extension(args.get_output_file());
+    if(args.has_output_compression()){
+        compression = compression_from_name(args.get_output_compression());
+    }
+    if(args.get_output_format() == ddnnf_file_format::BINARY_FILE_TYPE){
+        // binary files are written in place, without compression
+        ddnnf.serialize_binary(args.get_output_file().c_str());
+    }else{
+        write_output(ddnnf,args.get_output_file(),args.get_output_format(),compression,args.has_pipeline());
     }
     end_time = std::chrono::high_resolution_clock::now();
     duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    std::cout << "Saved output in " << duration.count() << " ms" << std::endl;
+    std::cerr << "Saved output in " << duration.count() << " ms" << std::endl;
+    stats.add_phase("write",duration.count());
     
     // exit
-    return 0;
+    write_stats(args,stats);
+    return exit_code;
 }
\ No newline at end of file
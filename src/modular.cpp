@@ -0,0 +1,219 @@
+#include "modular.h"
+#include "error.h"
+#include <iostream>
+#include <cstdlib>
+
+// below this size schoolbook multiplication is faster than NTT
+const size_t NAIVE_MULTIPLY_THRESHOLD = 32;
+
+uint64_t mod_add(uint64_t a, uint64_t b, uint64_t p){
+    uint64_t sum = a + b;
+    return sum >= p ? sum - p : sum;
+}
+
+uint64_t mod_sub(uint64_t a, uint64_t b, uint64_t p){
+    return a >= b ? a - b : a + p - b;
+}
+
+uint64_t mod_mul(uint64_t a, uint64_t b, uint64_t p){
+    return (uint64_t)(((unsigned __int128)a * b) % p);
+}
+
+uint64_t mod_pow(uint64_t base, uint64_t exponent, uint64_t p){
+    uint64_t result = 1 % p;
+    base %= p;
+    while(exponent > 0){
+        if(exponent & 1){
+            result = mod_mul(result,base,p);
+        }
+        base = mod_mul(base,base,p);
+        exponent >>= 1;
+    }
+    return result;
+}
+
+uint64_t mod_inv(uint64_t a, uint64_t p){
+    // p is always prime, so Fermat's little theorem applies
+    return mod_pow(a,p-2,p);
+}
+
+bool is_prime(uint64_t n){
+    if(n < 2){return false;}
+    const uint64_t bases[] = {2,3,5,7,11,13,17,19,23,29,31,37};
+    for(uint64_t base: bases){
+        if(n % base == 0){return n == base;}
+    }
+    // deterministic Miller-Rabin for all 64 bit integers
+    uint64_t d = n - 1;
+    int s = 0;
+    while((d & 1) == 0){
+        d >>= 1;
+        s++;
+    }
+    for(uint64_t base: bases){
+        uint64_t x = mod_pow(base,d,n);
+        if(x == 1 || x == n - 1){continue;}
+        bool composite = true;
+        for(int i = 1; i < s; i++){
+            x = mod_mul(x,x,n);
+            if(x == n - 1){
+                composite = false;
+                break;
+            }
+        }
+        if(composite){return false;}
+    }
+    return true;
+}
+
+NTTPrime::NTTPrime(uint64_t prime, int max_log){
+    this->prime = prime;
+    this->max_log = max_log;
+    // search a generator of the subgroup of order 2^max_log:
+    // w = a^((p-1)/2^max_log) has exactly that order
+    // iff w^(2^(max_log-1)) is not 1
+    uint64_t exponent = (prime - 1) >> max_log;
+    for(uint64_t a = 2; ; a++){
+        uint64_t w = mod_pow(a,exponent,prime);
+        if(max_log == 0 || mod_pow(w,1ULL << (max_log - 1),prime) != 1){
+            this->root = w;
+            break;
+        }
+    }
+}
+
+std::vector<uint64_t> find_primes(int count){
+    std::vector<uint64_t> primes = std::vector<uint64_t>();
+    uint64_t candidate = (1ULL << MODULAR_PRIME_BITS) - 1;
+    while((int)primes.size() < count){
+        if(is_prime(candidate)){
+            primes.push_back(candidate);
+        }
+        candidate -= 2;
+    }
+    return primes;
+}
+
+std::vector<NTTPrime> find_ntt_primes(int count, int two_adicity){
+    if(two_adicity < 0 || two_adicity > 40){
+        fail(std::string("Unsupported NTT size 2^") + std::to_string(two_adicity));
+    }
+    std::vector<NTTPrime> primes = std::vector<NTTPrime>();
+    uint64_t step = 1ULL << two_adicity;
+    uint64_t multiplier = ((1ULL << MODULAR_PRIME_BITS) - 2) / step;
+    while((int)primes.size() < count){
+        if(multiplier == 0){
+            fail("Not enough NTT primes available");
+        }
+        uint64_t candidate = multiplier * step + 1;
+        if(is_prime(candidate)){
+            primes.push_back(NTTPrime(candidate,two_adicity));
+        }
+        multiplier--;
+    }
+    return primes;
+}
+
+void ntt(std::vector<uint64_t>& a, bool invert, const NTTPrime& prime){
+    uint64_t p = prime.prime;
+    size_t n = a.size();
+    int log_n = 0;
+    while((1ULL << log_n) < n){log_n++;}
+
+    // bit reversal permutation
+    for(size_t i = 1, j = 0; i < n; i++){
+        size_t bit = n >> 1;
+        for(; j & bit; bit >>= 1){
+            j ^= bit;
+        }
+        j ^= bit;
+        if(i < j){std::swap(a[i],a[j]);}
+    }
+
+    for(int level = 1; level <= log_n; level++){
+        size_t length = 1ULL << level;
+        uint64_t w_length = mod_pow(prime.root,1ULL << (prime.max_log - level),p);
+        if(invert){
+            w_length = mod_inv(w_length,p);
+        }
+        for(size_t i = 0; i < n; i += length){
+            uint64_t w = 1;
+            for(size_t j = 0; j < length / 2; j++){
+                uint64_t u = a[i + j];
+                uint64_t v = mod_mul(a[i + j + length / 2],w,p);
+                a[i + j] = mod_add(u,v,p);
+                a[i + j + length / 2] = mod_sub(u,v,p);
+                w = mod_mul(w,w_length,p);
+            }
+        }
+    }
+
+    if(invert){
+        uint64_t n_inv = mod_inv(n % p,p);
+        for(size_t i = 0; i < n; i++){
+            a[i] = mod_mul(a[i],n_inv,p);
+        }
+    }
+}
+
+std::vector<uint64_t> poly_multiply(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, const NTTPrime& prime){
+    if(a.empty() || b.empty()){
+        return std::vector<uint64_t>();
+    }
+    uint64_t p = prime.prime;
+    size_t result_size = a.size() + b.size() - 1;
+    if(std::min(a.size(),b.size()) <= NAIVE_MULTIPLY_THRESHOLD){
+        std::vector<uint64_t> result = std::vector<uint64_t>(result_size,0);
+        for(size_t i = 0; i < a.size(); i++){
+            if(a[i] == 0){continue;}
+            for(size_t j = 0; j < b.size(); j++){
+                result[i + j] = mod_add(result[i + j],mod_mul(a[i],b[j],p),p);
+            }
+        }
+        return result;
+    }
+    size_t n = 1;
+    int log_n = 0;
+    while(n < result_size){
+        n <<= 1;
+        log_n++;
+    }
+    if(log_n > prime.max_log){
+        fail("Polynomial too large for NTT prime");
+    }
+    std::vector<uint64_t> fa = std::vector<uint64_t>(a.begin(),a.end());
+    std::vector<uint64_t> fb = std::vector<uint64_t>(b.begin(),b.end());
+    fa.resize(n,0);
+    fb.resize(n,0);
+    ntt(fa,false,prime);
+    ntt(fb,false,prime);
+    for(size_t i = 0; i < n; i++){
+        fa[i] = mod_mul(fa[i],fb[i],p);
+    }
+    ntt(fa,true,prime);
+    fa.resize(result_size);
+    return fa;
+}
+
+BigInt crt_reconstruct(const std::vector<uint64_t>& residues, const std::vector<uint64_t>& primes){
+    // mixed radix digits: value = x0 + x1*p0 + x2*p0*p1 + ...
+    size_t k = primes.size();
+    std::vector<uint64_t> digits = std::vector<uint64_t>(k,0);
+    for(size_t i = 0; i < k; i++){
+        uint64_t p = primes[i];
+        uint64_t value = 0;
+        uint64_t coefficient = 1;
+        for(size_t j = 0; j < i; j++){
+            value = mod_add(value,mod_mul(digits[j] % p,coefficient,p),p);
+            coefficient = mod_mul(coefficient,primes[j] % p,p);
+        }
+        digits[i] = mod_mul(mod_sub(residues[i] % p,value,p),mod_inv(coefficient,p),p);
+    }
+    // evaluate mixed radix representation with Horner's rule
+    BigInt result = BigInt();
+    for(int i = k - 1; i >= 0; i--){
+        result.mul_small(primes[i]);
+        result.add_small(digits[i]);
+    }
+    return result;
+}
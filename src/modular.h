@@ -0,0 +1,43 @@
+#ifndef __MODULAR_H__
+#define __MODULAR_H__
+
+#include <vector>
+#include <cstdint>
+#include "bigint.h"
+
+// all primes used by the modular routines are below 2^62,
+// so that the sum of two residues never overflows
+const int MODULAR_PRIME_BITS = 62;
+
+// prime p = c * 2^k + 1 together with a root of unity
+// of order 2^k, used for number theoretic transforms
+class NTTPrime{
+    public:
+    uint64_t prime;
+    uint64_t root; // root of unity of order 2^max_log
+    int max_log; // largest supported transform is 2^max_log
+    NTTPrime(uint64_t prime, int max_log);
+};
+
+uint64_t mod_add(uint64_t a, uint64_t b, uint64_t p);
+uint64_t mod_sub(uint64_t a, uint64_t b, uint64_t p);
+uint64_t mod_mul(uint64_t a, uint64_t b, uint64_t p);
+uint64_t mod_pow(uint64_t base, uint64_t exponent, uint64_t p);
+uint64_t mod_inv(uint64_t a, uint64_t p);
+bool is_prime(uint64_t n);
+
+// returns the largest count primes below 2^62
+std::vector<uint64_t> find_primes(int count);
+
+// returns the largest count primes below 2^62
+// such that 2^two_adicity divides p-1
+std::vector<NTTPrime> find_ntt_primes(int count, int two_adicity);
+
+// product of two polynomials with coefficients modulo prime.prime
+std::vector<uint64_t> poly_multiply(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, const NTTPrime& prime);
+
+// rebuilds the unique integer smaller than the product of
+// primes having the given residues (Garner's algorithm)
+BigInt crt_reconstruct(const std::vector<uint64_t>& residues, const std::vector<uint64_t>& primes);
+
+#endif
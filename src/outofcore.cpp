@@ -0,0 +1,270 @@
+#include "outofcore.h"
+#include "binary.h"
+#include "parser.h"
+#include "stream.h"
+#include "error.h"
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// markers stored in place of node ids, above every valid id
+const uint32_t MAPPED_TRUE = 0xFFFFFFFFu;
+const uint32_t MAPPED_FALSE = 0xFFFFFFFEu;
+// windows never get smaller than this many nodes
+const uint64_t MIN_WINDOW_NODES = 1 << 12;
+const size_t CONVERT_BLOCK_SIZE = 1 << 20;
+
+// Array of uint32 stored in a mapped temporary file, so that its pages
+// can be dropped from memory and read back when needed
+class ScratchArray{
+    private:
+    uint32_t* data;
+    size_t length;
+
+    public:
+    ScratchArray(size_t length){
+        this->length = length;
+        int descriptor = open_temporary_file();
+        if(ftruncate(descriptor,length * sizeof(uint32_t)) != 0){
+            close(descriptor);
+            fail("Unable to create a temporary file");
+        }
+        void* mapping = mmap(nullptr,length * sizeof(uint32_t),PROT_READ | PROT_WRITE,MAP_SHARED,descriptor,0);
+        close(descriptor);
+        if(mapping == MAP_FAILED){
+            fail("Unable to map a temporary file");
+        }
+        // the file starts zeroed
+        data = (uint32_t*)mapping;
+    }
+    ScratchArray(const ScratchArray& other) = delete;
+    ScratchArray& operator=(const ScratchArray& other) = delete;
+    ~ScratchArray(){
+        munmap(data,length * sizeof(uint32_t));
+    }
+    uint32_t& operator[](size_t index){
+        return data[index];
+    }
+    // drops entries [first,last) from memory, their values are kept in the file
+    void release(size_t first, size_t last){
+        if(last > length){last = length;}
+        if(first >= last){return;}
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t begin = first * sizeof(uint32_t) / page * page;
+        size_t end = last * sizeof(uint32_t);
+        madvise((char*)data + begin,end - begin,MADV_DONTNEED);
+    }
+};
+
+bool is_constant(uint32_t mapped){
+    return mapped == MAPPED_TRUE || mapped == MAPPED_FALSE;
+}
+
+void condition_out_of_core(const char* input, const char* output, const std::set<int>& conditions, size_t memory_budget){
+    BinaryNodeFile file(input);
+    uint64_t node_count = file.node_count();
+    int total_variables = file.total_variables();
+    // same checks as DDNNF::condition_all
+    std::vector<char> assigned = std::vector<char>(total_variables + 1,0);
+    for(int var: conditions){
+        if(var == 0){
+            fail("Cannot condition on 0");
+        }
+        if(abs(var) > total_variables){
+            fail("Invalid literal to condition");
+        }
+        if(conditions.find(-var) != conditions.end()){
+            fail("Cannot condition on both a variable and its negation");
+        }
+        assigned[abs(var)] = var > 0 ? 1 : -1;
+    }
+
+    // about half of the budget is kept for the window being scanned, the
+    // other half for the pages of earlier nodes read through child ids
+    uint64_t node_bytes = sizeof(BinaryNode) + 2 * sizeof(uint32_t) + file.edge_count() * sizeof(uint32_t) / node_count;
+    uint64_t window = std::max(MIN_WINDOW_NODES,(uint64_t)(memory_budget / 2 / node_bytes));
+
+    // pass 1, children first: replace conditioned literals by constants,
+    // propagate constants and skip nodes left with a single child.
+    // mapped[i] is a constant or the id of the node standing for node i
+    ScratchArray mapped(node_count);
+    for(uint64_t id = 0; id < node_count; id++){
+        if(id % window == 0 && id >= window){
+            file.release(0,id - window);
+            mapped.release(0,id - window);
+        }
+        file.check_node(id);
+        switch(file.type(id)){
+            case DDNNF_TRUE: mapped[id] = MAPPED_TRUE; break;
+            case DDNNF_FALSE: mapped[id] = MAPPED_FALSE; break;
+            case DDNNF_LITERAL:{
+                int var = file.var(id);
+                char value = assigned[abs(var)];
+                if(value == 0){
+                    mapped[id] = id;
+                }else{
+                    mapped[id] = (value > 0) == (var > 0) ? MAPPED_TRUE : MAPPED_FALSE;
+                }
+            } break;
+            case DDNNF_AND:
+            case DDNNF_OR:{
+                // an AND ignores true children and is false with a false
+                // child, an OR is the other way around
+                uint32_t neutral = file.type(id) == DDNNF_AND ? MAPPED_TRUE : MAPPED_FALSE;
+                uint32_t absorbing = file.type(id) == DDNNF_AND ? MAPPED_FALSE : MAPPED_TRUE;
+                const uint32_t* children = file.children(id);
+                uint32_t result = neutral;
+                bool single = true;
+                for(uint64_t i = 0; i < file.child_count(id); i++){
+                    uint32_t child = mapped[children[i]];
+                    if(child == neutral){continue;}
+                    if(child == absorbing){
+                        result = absorbing;
+                        single = true;
+                        break;
+                    }
+                    if(result != neutral && result != child){single = false;}
+                    result = child;
+                }
+                mapped[id] = single ? result : id;
+            } break;
+        }
+    }
+    uint32_t root = mapped[file.root()];
+    file.release(0,node_count);
+    mapped.release(0,node_count);
+
+    // pass 2, parents first: mark the nodes reachable from the root
+    ScratchArray kept(node_count);
+    if(!is_constant(root)){kept[root] = 1;}
+    for(uint64_t id = node_count; id-- > 0;){
+        if((node_count - id) % window == 0 && node_count - id >= 2 * window){
+            file.release(id + window,node_count);
+            mapped.release(id + window,node_count);
+            kept.release(id + window,node_count);
+        }
+        if(kept[id] == 0){continue;}
+        const uint32_t* children = file.children(id);
+        for(uint64_t i = 0; i < file.child_count(id); i++){
+            uint32_t child = mapped[children[i]];
+            if(!is_constant(child)){kept[child] = 1;}
+        }
+    }
+    file.release(0,node_count);
+    mapped.release(0,node_count);
+    kept.release(0,node_count);
+
+    // pass 3, children first: write the reachable nodes, kept[i] becomes
+    // the new id of node i plus one
+    BinaryNodeWriter writer(output);
+    std::vector<uint32_t> new_children = std::vector<uint32_t>();
+    for(uint64_t id = 0; id < node_count; id++){
+        if(id % window == 0 && id >= window){
+            file.release(0,id - window);
+            mapped.release(0,id - window);
+            kept.release(0,id - window);
+        }
+        if(kept[id] == 0){continue;}
+        ddnnf_node_type type = file.type(id);
+        new_children.clear();
+        const uint32_t* children = file.children(id);
+        for(uint64_t i = 0; i < file.child_count(id); i++){
+            // the remaining constants are neutral for this node
+            uint32_t child = mapped[children[i]];
+            if(is_constant(child)){continue;}
+            new_children.push_back(kept[child] - 1);
+        }
+        std::sort(new_children.begin(),new_children.end());
+        new_children.erase(std::unique(new_children.begin(),new_children.end()),new_children.end());
+        int var = file.var(id);
+        // a decision node stays a decision only if no branch was dropped
+        if(type == DDNNF_OR && new_children.size() != file.child_count(id)){var = 0;}
+        if(type == DDNNF_AND){var = 0;}
+        kept[id] = writer.add_node(type,var,new_children.data(),new_children.size()) + 1;
+    }
+
+    // as in memory, the result is the conjunction of the conditioned
+    // literals and the simplified circuit
+    if(root == MAPPED_FALSE){
+        writer.finish(total_variables,writer.add_node(DDNNF_FALSE,0,nullptr,0));
+        return;
+    }
+    std::vector<uint32_t> parts = std::vector<uint32_t>();
+    for(int var: conditions){
+        parts.push_back(writer.add_node(DDNNF_LITERAL,var,nullptr,0));
+    }
+    if(root != MAPPED_TRUE){
+        parts.push_back(kept[root] - 1);
+    }
+    if(parts.size() == 0){
+        writer.finish(total_variables,writer.add_node(DDNNF_TRUE,0,nullptr,0));
+    }else if(parts.size() == 1){
+        writer.finish(total_variables,parts[0]);
+    }else{
+        std::sort(parts.begin(),parts.end());
+        writer.finish(total_variables,writer.add_node(DDNNF_AND,0,parts.data(),parts.size()));
+    }
+}
+
+void print_text_format_error(){
+    fail("File is not in c2d nnf format");
+}
+
+void convert_to_binary(const char* input, const char* output, bool c2d){
+    InputFile infile(input,false);
+    BinaryNodeWriter writer(output);
+    ParsedChunk chunk = ParsedChunk();
+    std::vector<uint32_t> children = std::vector<uint32_t>();
+    bool found_header = false;
+    int total_variables = 0;
+    // same checks as the in-memory loader
+    read_line_blocks(infile.stream(),CONVERT_BLOCK_SIZE,[&](const char* begin, const char* end){
+        chunk.clear();
+        parse_c2d_lines(begin,end,chunk);
+        for(size_t record = 0; record < chunk.size(); record++){
+            char kind = chunk.kind(record);
+            const int* values = chunk.record_values(record);
+            int value_count = chunk.value_count(record);
+            // first line should be "nnf <num_nodes> <num_edges> <num_vars>"
+            if((kind == 'n') == found_header){print_text_format_error();}
+            switch(kind){
+                case 'n':{
+                    if(values[0] < 0){print_text_format_error();}
+                    found_header = true;
+                    total_variables = values[0];
+                } break;
+                case 'L':{
+                    if(values[0] == 0 || abs(values[0]) > total_variables){
+                        fail("Invalid literal");
+                    }
+                    writer.add_node(DDNNF_LITERAL,values[0],nullptr,0);
+                } break;
+                case 'A':
+                case 'O':{
+                    int offset = kind == 'O' ? 1 : 0;
+                    int count = values[offset];
+                    if(count == 0){
+                        writer.add_node(kind == 'A' ? DDNNF_TRUE : DDNNF_FALSE,0,nullptr,0);
+                        break;
+                    }
+                    if(kind == 'O' && c2d && count != 2){print_text_format_error();}
+                    uint64_t node_id = writer.size();
+                    children.clear();
+                    for(int i = offset + 1; i < value_count; i++){
+                        if(values[i] < 0 || (uint64_t)values[i] >= node_id){print_text_format_error();}
+                        children.push_back(values[i]);
+                    }
+                    writer.add_node(kind == 'A' ? DDNNF_AND : DDNNF_OR,kind == 'O' ? abs(values[0]) : 0,children.data(),children.size());
+                } break;
+            }
+        }
+        if(chunk.failed){print_text_format_error();}
+    });
+    if(writer.size() == 0){
+        fail("No nodes found");
+    }
+    // the last node is the root
+    writer.finish(total_variables,writer.size() - 1);
+}
@@ -0,0 +1,21 @@
+#ifndef __OUTOFCORE_H__
+#define __OUTOFCORE_H__
+
+#include <set>
+#include <cstddef>
+
+// Out-of-core processing for circuits that do not fit in memory: the
+// binary node file is mapped and scanned sequentially in topological
+// order, scratch arrays live in mapped temporary files, and pages
+// outside the current window of nodes are dropped, so that resident
+// memory stays around memory_budget bytes
+
+// conditions the binary circuit in input on the given literals, removes
+// constants, single child nodes and unreachable nodes, and writes the
+// result to output as a binary circuit
+void condition_out_of_core(const char* input, const char* output, const std::set<int>& conditions, size_t memory_budget);
+// streams a c2d (or library, when c2d is false) nnf file into a binary
+// circuit, without holding the nodes in memory
+void convert_to_binary(const char* input, const char* output, bool c2d);
+
+#endif
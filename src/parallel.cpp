@@ -0,0 +1,160 @@
+#include "parallel.h"
+
+void parallel_for(int count, int threads, const std::function<void(int)>& body){
+    if(threads > count){
+        threads = count;
+    }
+    if(threads <= 1){
+        // no need to spawn threads
+        for(int i = 0; i < count; i++){
+            body(i);
+        }
+        return;
+    }
+    std::atomic<int> next_task(0);
+    // the first error stops the remaining tasks and is rethrown here
+    std::exception_ptr error;
+    std::mutex error_lock;
+    std::vector<std::thread> workers = std::vector<std::thread>();
+    for(int t = 0; t < threads; t++){
+        workers.push_back(std::thread([&](){
+            while(true){
+                int task = next_task.fetch_add(1);
+                if(task >= count){break;}
+                try{
+                    body(task);
+                }catch(...){
+                    std::lock_guard<std::mutex> guard(error_lock);
+                    if(!error){error = std::current_exception();}
+                    next_task = count;
+                }
+            }
+        }));
+    }
+    for(auto& worker: workers){
+        worker.join();
+    }
+    if(error){std::rethrow_exception(error);}
+}
+
+WorkStealingPool::WorkStealingPool(int threads){
+    if(threads < 1){threads = 1;}
+    job = nullptr;
+    chunks_left = 0;
+    failed = false;
+    generation = 0;
+    stopping = false;
+    for(int t = 0; t < threads; t++){
+        queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+    // queue 0 belongs to the thread calling run
+    for(int t = 1; t < threads; t++){
+        workers.push_back(std::thread(&WorkStealingPool::worker_loop,this,t));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool(){
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        stopping = true;
+    }
+    start_signal.notify_all();
+    for(auto& worker: workers){
+        worker.join();
+    }
+}
+
+int WorkStealingPool::size()const{
+    return queues.size();
+}
+
+bool WorkStealingPool::pop_chunk(int queue_id, std::pair<int,int>& chunk){
+    // own chunks are taken from the back, stolen ones from the front
+    {
+        WorkQueue& own = *queues[queue_id];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if(!own.chunks.empty()){
+            chunk = own.chunks.back();
+            own.chunks.pop_back();
+            return true;
+        }
+    }
+    int count = queues.size();
+    for(int offset = 1; offset < count; offset++){
+        WorkQueue& victim = *queues[(queue_id + offset) % count];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if(!victim.chunks.empty()){
+            chunk = victim.chunks.front();
+            victim.chunks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::work(int queue_id){
+    std::pair<int,int> chunk;
+    while(pop_chunk(queue_id,chunk)){
+        // after an error the remaining chunks are only counted down
+        if(!failed){
+            try{
+                (*job)(chunk.first,chunk.second);
+            }catch(...){
+                std::lock_guard<std::mutex> guard(state_lock);
+                if(!error){error = std::current_exception();}
+                failed = true;
+            }
+        }
+        if(chunks_left.fetch_sub(1) == 1){
+            std::lock_guard<std::mutex> guard(state_lock);
+            done_signal.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::worker_loop(int queue_id){
+    long seen_generation = 0;
+    while(true){
+        {
+            std::unique_lock<std::mutex> guard(state_lock);
+            start_signal.wait(guard,[&](){return stopping || generation != seen_generation;});
+            if(stopping){return;}
+            seen_generation = generation;
+        }
+        work(queue_id);
+    }
+}
+
+void WorkStealingPool::run(int count, int chunk_size, const std::function<void(int,int)>& body){
+    if(count <= 0){return;}
+    if(chunk_size < 1){chunk_size = 1;}
+    if(queues.size() == 1 || count <= chunk_size){
+        body(0,count);
+        return;
+    }
+    int chunk_count = (count + chunk_size - 1) / chunk_size;
+    job = &body;
+    chunks_left = chunk_count;
+    failed = false;
+    error = std::exception_ptr();
+    // consecutive chunks go to the same queue so that
+    // threads mostly work on neighbouring nodes
+    int queue_count = queues.size();
+    for(int q = 0; q < queue_count; q++){
+        int first_chunk = (long)chunk_count * q / queue_count;
+        int last_chunk = (long)chunk_count * (q + 1) / queue_count;
+        std::lock_guard<std::mutex> guard(queues[q]->lock);
+        for(int c = first_chunk; c < last_chunk; c++){
+            queues[q]->chunks.push_back(std::make_pair(c * chunk_size,std::min(count,(c + 1) * chunk_size)));
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        generation++;
+    }
+    start_signal.notify_all();
+    work(0);
+    std::unique_lock<std::mutex> guard(state_lock);
+    done_signal.wait(guard,[&](){return chunks_left == 0;});
+    if(error){std::rethrow_exception(error);}
+}
@@ -0,0 +1,54 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <exception>
+
+// runs body(0) ... body(count-1) on up to threads threads;
+// tasks are handed out one at a time through a shared counter,
+// the first exception of a task stops the others and is rethrown
+void parallel_for(int count, int threads, const std::function<void(int)>& body);
+
+// Fixed set of threads running ranges of indices; every thread owns a
+// queue of chunks and steals from the other queues once its own is empty,
+// so uneven chunks do not leave threads idle. The thread calling run
+// takes part in the work, threads are reused across calls.
+class WorkStealingPool{
+    private:
+    struct WorkQueue{
+        std::mutex lock;
+        std::deque<std::pair<int,int>> chunks; // [first,last) ranges
+    };
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::mutex state_lock;
+    std::condition_variable start_signal;
+    std::condition_variable done_signal;
+    const std::function<void(int,int)>* job;
+    std::atomic<int> chunks_left;
+    std::atomic<bool> failed; // a chunk of the current run threw
+    std::exception_ptr error;
+    long generation; // incremented by every call to run
+    bool stopping;
+    bool pop_chunk(int queue_id, std::pair<int,int>& chunk);
+    void work(int queue_id);
+    void worker_loop(int queue_id);
+
+    public:
+    WorkStealingPool(int threads);
+    ~WorkStealingPool();
+    int size()const;
+    // calls body(first,last) on chunks of at most chunk_size
+    // indices covering [0,count), returns once all are done and
+    // rethrows the first exception of body
+    void run(int count, int chunk_size, const std::function<void(int,int)>& body);
+};
+
+#endif
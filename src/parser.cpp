@@ -0,0 +1,327 @@
+#include "parser.h"
+#include "error.h"
+#include <iostream>
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+ParsedChunk::ParsedChunk(){
+    kinds = std::vector<char>();
+    starts = std::vector<size_t>(1,0);
+    values = std::vector<int>();
+    failed = false;
+    error = std::string();
+}
+
+size_t ParsedChunk::size()const{
+    return kinds.size();
+}
+
+char ParsedChunk::kind(size_t record)const{
+    return kinds[record];
+}
+
+size_t ParsedChunk::value_count(size_t record)const{
+    return starts[record + 1] - starts[record];
+}
+
+const int* ParsedChunk::record_values(size_t record)const{
+    return values.data() + starts[record];
+}
+
+void ParsedChunk::begin_record(char kind){
+    kinds.push_back(kind);
+    starts.push_back(values.size());
+}
+
+void ParsedChunk::add_value(int value){
+    values.push_back(value);
+    starts.back() = values.size();
+}
+
+void ParsedChunk::drop_record(){
+    kinds.pop_back();
+    starts.pop_back();
+    values.resize(starts.back());
+}
+
+void ParsedChunk::fail(const std::string& reason){
+    failed = true;
+    error = reason;
+}
+
+void ParsedChunk::clear(){
+    kinds.clear();
+    starts.assign(1,0);
+    values.clear();
+    failed = false;
+    error.clear();
+}
+
+// same separators as operator>> on a line read with getline
+bool is_blank(char c){
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// finds the next token of the line, returns false at the end of the line
+bool next_token(const char*& pos, const char* line_end, const char*& token, const char*& token_end){
+    while(pos < line_end && is_blank(*pos)){pos++;}
+    if(pos == line_end){return false;}
+    token = pos;
+    while(pos < line_end && !is_blank(*pos)){pos++;}
+    token_end = pos;
+    return true;
+}
+
+// parses the integer prefix of a token like std::stoi,
+// returns false if there is none or it does not fit an int
+bool parse_int(const char* token, const char* token_end, int& value){
+    bool negative = false;
+    if(token < token_end && (*token == '-' || *token == '+')){
+        negative = *token == '-';
+        token++;
+    }
+    if(token == token_end || *token < '0' || *token > '9'){return false;}
+    long long result = 0;
+    while(token < token_end && *token >= '0' && *token <= '9'){
+        result = result * 10 + (*token - '0');
+        if(result > (long long)INT_MAX + 1){return false;}
+        token++;
+    }
+    if(negative){result = -result;}
+    if(result > INT_MAX || result < INT_MIN){return false;}
+    value = (int)result;
+    return true;
+}
+
+// reads the next token of the line as an integer
+bool next_int(const char*& pos, const char* line_end, int& value){
+    const char* token;
+    const char* token_end;
+    if(!next_token(pos,line_end,token,token_end)){return false;}
+    return parse_int(token,token_end,value);
+}
+
+const char* find_line_end(const char* pos, const char* end){
+    while(pos < end && *pos != '\n'){pos++;}
+    return pos;
+}
+
+// returns false if the c2d line is malformed
+bool parse_c2d_line(const char* pos, const char* line_end, ParsedChunk& chunk){
+    const char* token;
+    const char* token_end;
+    // skip empty lines
+    if(!next_token(pos,line_end,token,token_end)){return true;}
+    if(token_end - token == 3 && std::string(token,token_end) == "nnf"){
+        // header "nnf <num_nodes> <num_edges> <num_vars>", only
+        // the number of variables has to be an integer
+        chunk.begin_record('n');
+        for(int i = 0; i < 2; i++){
+            if(!next_token(pos,line_end,token,token_end)){return false;}
+        }
+        int num_vars;
+        if(!next_int(pos,line_end,num_vars)){return false;}
+        chunk.add_value(num_vars);
+        return true;
+    }
+    // node lines should be "<node_type> node_data..."
+    if(token_end - token != 1){return false;}
+    char node_type = *token;
+    int count;
+    chunk.begin_record(node_type);
+    switch(node_type){
+        case 'L':{
+            int var;
+            if(!next_int(pos,line_end,var)){return false;}
+            chunk.add_value(var);
+            return true;
+        }
+        case 'O':{
+            // decision variable j, 0 if the node is not a decision
+            int decision_var;
+            if(!next_int(pos,line_end,decision_var)){return false;}
+            chunk.add_value(decision_var);
+            // the children follow, same layout as AND nodes
+        }
+        // fall through
+        case 'A':{
+            if(!next_int(pos,line_end,count)){return false;}
+            chunk.add_value(count);
+            for(int i = 0; i < count; i++){
+                int child_id;
+                if(!next_int(pos,line_end,child_id)){return false;}
+                chunk.add_value(child_id);
+            }
+            return true;
+        }
+        default: return false;
+    }
+}
+
+void parse_c2d_lines(const char* begin, const char* end, ParsedChunk& chunk){
+    const char* pos = begin;
+    while(pos < end){
+        const char* line_end = find_line_end(pos,end);
+        size_t records = chunk.size();
+        if(!parse_c2d_line(pos,line_end,chunk)){
+            if(chunk.size() > records){chunk.drop_record();}
+            chunk.fail("");
+            return;
+        }
+        pos = line_end + 1;
+    }
+}
+
+// returns an empty string if the d4 line is well formed
+std::string parse_d4_line(const char* pos, const char* line_end, ParsedChunk& chunk){
+    const char* token;
+    const char* token_end;
+    // skip empty lines
+    if(!next_token(pos,line_end,token,token_end)){return "";}
+    char node_type = *token;
+    switch(node_type){
+        case 'a':
+        case 'o':
+        case 't':
+        case 'f':{
+            chunk.begin_record(node_type);
+            return "";
+        }
+        default:{
+            // line is edge, should start with a number
+            if(node_type < '0' || node_type > '9'){return "node type is not digit";}
+        }
+    }
+    int source_id;
+    int destination_id;
+    if(!parse_int(token,token_end,source_id)){return "source id is not integer";}
+    if(!next_token(pos,line_end,token,token_end)){return "cannot find destination for source";}
+    if(!parse_int(token,token_end,destination_id)){return "destination id is not integer";}
+    if(source_id == destination_id){return "source and dst are the same";}
+    chunk.begin_record('e');
+    chunk.add_value(source_id);
+    chunk.add_value(destination_id);
+    // literals, the line ends at 0
+    while(next_token(pos,line_end,token,token_end)){
+        int literal;
+        if(!parse_int(token,token_end,literal)){return "literal is not integer";}
+        if(literal == 0){break;}
+        chunk.add_value(literal);
+    }
+    return "";
+}
+
+void parse_d4_lines(const char* begin, const char* end, ParsedChunk& chunk){
+    const char* pos = begin;
+    while(pos < end){
+        const char* line_end = find_line_end(pos,end);
+        size_t records = chunk.size();
+        std::string error = parse_d4_line(pos,line_end,chunk);
+        if(!error.empty()){
+            if(chunk.size() > records){chunk.drop_record();}
+            chunk.fail(error);
+            return;
+        }
+        pos = line_end + 1;
+    }
+}
+
+std::vector<std::pair<const char*,const char*>> split_lines(const char* begin, const char* end, int count){
+    std::vector<std::pair<const char*,const char*>> pieces = std::vector<std::pair<const char*,const char*>>();
+    if(count < 1){count = 1;}
+    size_t length = end - begin;
+    const char* piece_begin = begin;
+    for(int i = 1; i <= count && piece_begin < end; i++){
+        const char* piece_end = i == count ? end : begin + length / count * i;
+        if(piece_end <= piece_begin){continue;}
+        // move the cut right after the next newline
+        piece_end = find_line_end(piece_end - 1,end);
+        if(piece_end < end){piece_end++;}
+        pieces.push_back(std::make_pair(piece_begin,piece_end));
+        piece_begin = piece_end;
+    }
+    return pieces;
+}
+
+void read_line_blocks(std::istream& in, size_t block_size, const std::function<void(const char*,const char*)>& consume){
+    std::vector<char> buffer = std::vector<char>(block_size);
+    size_t kept = 0; // bytes of an incomplete line carried over
+    while(true){
+        if(buffer.size() < kept + block_size){
+            buffer.resize(kept + block_size);
+        }
+        in.read(buffer.data() + kept,block_size);
+        size_t filled = kept + in.gcount();
+        if(in.gcount() == 0){
+            // end of the stream, the last line may lack a newline
+            if(filled > 0){consume(buffer.data(),buffer.data() + filled);}
+            return;
+        }
+        size_t cut = filled;
+        while(cut > 0 && buffer[cut - 1] != '\n'){cut--;}
+        if(cut == 0){
+            // no complete line yet, read more
+            kept = filled;
+            continue;
+        }
+        consume(buffer.data(),buffer.data() + cut);
+        std::copy(buffer.begin() + cut,buffer.begin() + filled,buffer.begin());
+        kept = filled - cut;
+    }
+}
+
+MappedFile::MappedFile(const char* filename){
+    data = nullptr;
+    length = 0;
+    int descriptor = open(filename,O_RDONLY);
+    if(descriptor < 0){
+        fail(std::string("Unable to open file ") + filename);
+    }
+    struct stat info;
+    if(fstat(descriptor,&info) != 0){
+        fail(std::string("Unable to open file ") + filename);
+    }
+    length = info.st_size;
+    if(length > 0){
+        void* mapping = mmap(nullptr,length,PROT_READ,MAP_PRIVATE,descriptor,0);
+        if(mapping == MAP_FAILED){
+            fail(std::string("Unable to map file ") + filename);
+        }
+        // the file is read front to back by each thread
+        madvise(mapping,length,MADV_SEQUENTIAL);
+        data = (const char*)mapping;
+    }
+    close(descriptor);
+}
+
+MappedFile::~MappedFile(){
+    if(data != nullptr){
+        munmap((void*)data,length);
+    }
+}
+
+const char* MappedFile::begin()const{
+    return data;
+}
+
+const char* MappedFile::end()const{
+    return data + length;
+}
+
+size_t MappedFile::size()const{
+    return length;
+}
+
+void MappedFile::release(const char* begin, const char* end)const{
+    if(data == nullptr){return;}
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t first = (size_t)(begin - data) / page * page;
+    size_t last = std::min(length,(size_t)(end - data));
+    if(last <= first){return;}
+    madvise((void*)(data + first),last - first,MADV_DONTNEED);
+}
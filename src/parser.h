@@ -0,0 +1,65 @@
+#ifndef __PARSER_H__
+#define __PARSER_H__
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <istream>
+#include <functional>
+
+// Lines of a piece of a c2d or d4 file reduced to a kind and a list of
+// integers, so that tokenizing can run apart from building the nodes.
+// Kinds are 'n' (c2d header), 'L', 'A', 'O' for c2d and 'a', 'o', 't',
+// 'f', 'e' (edge: source, destination, literals) for d4
+class ParsedChunk{
+    private:
+    std::vector<char> kinds;
+    std::vector<size_t> starts; // record i has values [starts[i],starts[i+1])
+    std::vector<int> values;
+
+    public:
+    bool failed; // parsing stopped at a malformed line
+    std::string error; // reason of the failure (d4 only)
+    ParsedChunk();
+    size_t size()const;
+    char kind(size_t record)const;
+    size_t value_count(size_t record)const;
+    const int* record_values(size_t record)const;
+    void begin_record(char kind);
+    void add_value(int value);
+    void drop_record(); // removes the record being parsed
+    void fail(const std::string& reason);
+    void clear();
+};
+
+// tokenizes complete lines, stops at the first malformed one
+void parse_c2d_lines(const char* begin, const char* end, ParsedChunk& chunk);
+void parse_d4_lines(const char* begin, const char* end, ParsedChunk& chunk);
+
+// splits [begin,end) in at most count pieces ending right after a newline
+std::vector<std::pair<const char*,const char*>> split_lines(const char* begin, const char* end, int count);
+
+// reads the stream in blocks and hands them to consume, every
+// block but the last one ends right after a newline
+void read_line_blocks(std::istream& in, size_t block_size, const std::function<void(const char*,const char*)>& consume);
+
+// read only memory map of a whole file
+class MappedFile{
+    private:
+    const char* data;
+    size_t length;
+
+    public:
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+    MappedFile(const char* filename); // exits if the file cannot be mapped
+    ~MappedFile();
+    const char* begin()const;
+    const char* end()const;
+    size_t size()const;
+    // drops the pages of [begin,end) from memory, they are
+    // read again from the file if they are accessed later
+    void release(const char* begin, const char* end)const;
+};
+
+#endif
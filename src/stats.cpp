@@ -0,0 +1,84 @@
+#include "stats.h"
+
+DDNNFStats::DDNNFStats(){
+    phases = std::vector<std::pair<std::string,double>>();
+    simplify_truth_ms = 0;
+    remove_unreferenced_ms = 0;
+    recompute_indexes_ms = 0;
+    recompute_mentioned_vars_ms = 0;
+    simplify_calls = 0;
+    constants_propagated = 0;
+    single_children_bypassed = 0;
+    children_merged = 0;
+    unreferenced_removed = 0;
+    condition_steps = std::vector<ConditionStep>();
+}
+
+void DDNNFStats::add_phase(const std::string& name, double milliseconds){
+    phases.push_back(std::make_pair(name,milliseconds));
+}
+
+void DDNNFStats::add(const DDNNFStats& other){
+    simplify_truth_ms += other.simplify_truth_ms;
+    remove_unreferenced_ms += other.remove_unreferenced_ms;
+    recompute_indexes_ms += other.recompute_indexes_ms;
+    recompute_mentioned_vars_ms += other.recompute_mentioned_vars_ms;
+    simplify_calls += other.simplify_calls;
+    constants_propagated += other.constants_propagated;
+    single_children_bypassed += other.single_children_bypassed;
+    children_merged += other.children_merged;
+    unreferenced_removed += other.unreferenced_removed;
+    condition_steps.insert(condition_steps.end(),other.condition_steps.begin(),other.condition_steps.end());
+}
+
+long DDNNFStats::nodes_deleted()const{
+    return constants_propagated + single_children_bypassed + children_merged + unreferenced_removed;
+}
+
+void DDNNFStats::write_json(std::ostream& out, long peak_rss_kb, long allocations)const{
+    // phase names are fixed identifiers, nothing needs escaping
+    out << "{\n";
+    out << "  \"phases_ms\": {";
+    for(size_t i = 0; i < phases.size(); i++){
+        out << (i == 0 ? "" : ",") << "\n    \"" << phases[i].first << "\": " << phases[i].second;
+    }
+    out << (phases.empty() ? "" : "\n  ") << "},\n";
+    out << "  \"simplify\": {\n";
+    out << "    \"calls\": " << simplify_calls << ",\n";
+    out << "    \"simplify_truth_ms\": " << simplify_truth_ms << ",\n";
+    out << "    \"remove_unreferenced_nodes_ms\": " << remove_unreferenced_ms << ",\n";
+    out << "    \"recompute_indexes_ms\": " << recompute_indexes_ms << ",\n";
+    out << "    \"recompute_mentioned_vars_ms\": " << recompute_mentioned_vars_ms << "\n";
+    out << "  },\n";
+    out << "  \"nodes_deleted\": " << nodes_deleted() << ",\n";
+    out << "  \"constants_propagated\": " << constants_propagated << ",\n";
+    out << "  \"single_children_bypassed\": " << single_children_bypassed << ",\n";
+    out << "  \"children_merged\": " << children_merged << ",\n";
+    out << "  \"unreferenced_removed\": " << unreferenced_removed << ",\n";
+    out << "  \"conditioning\": [";
+    for(size_t i = 0; i < condition_steps.size(); i++){
+        const ConditionStep& step = condition_steps[i];
+        out << (i == 0 ? "" : ",") << "\n    {\"literal\": " << step.literal;
+        out << ", \"nodes_before\": " << step.nodes_before << ", \"edges_before\": " << step.edges_before;
+        out << ", \"nodes_after\": " << step.nodes_after << ", \"edges_after\": " << step.edges_after;
+        out << ", \"ms\": " << step.milliseconds << "}";
+    }
+    out << (condition_steps.empty() ? "" : "\n  ") << "],\n";
+    out << "  \"peak_rss_kb\": " << peak_rss_kb << ",\n";
+    out << "  \"allocations\": " << allocations << "\n";
+    out << "}\n";
+}
+
+PhaseTimer::PhaseTimer(double* total){
+    this->total = total;
+    if(total != nullptr){
+        start = std::chrono::high_resolution_clock::now();
+    }
+}
+
+PhaseTimer::~PhaseTimer(){
+    if(total != nullptr){
+        auto end = std::chrono::high_resolution_clock::now();
+        *total += std::chrono::duration<double,std::milli>(end - start).count();
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <ostream>
+
+// size of the circuit around one DDNNF::condition call, or of the
+// component of a root AND when components are conditioned in parallel
+struct ConditionStep{
+    int literal;
+    long nodes_before;
+    long edges_before;
+    long nodes_after;
+    long edges_after;
+    double milliseconds;
+};
+
+// Timings and counters filled in by a DDNNF given to set_stats. Without
+// stats a DDNNF only checks for a null pointer once per phase or per
+// removed node, nothing is timed or counted.
+class DDNNFStats{
+    public:
+    std::vector<std::pair<std::string,double>> phases; // coarse phases timed by the caller, in ms
+    // time spent in the simplification steps, in ms
+    double simplify_truth_ms;
+    double remove_unreferenced_ms;
+    double recompute_indexes_ms;
+    double recompute_mentioned_vars_ms;
+    long simplify_calls;
+    // nodes deleted by simplification, by reason
+    long constants_propagated; // conditioned literals and AND or OR nodes replaced by true or false
+    long single_children_bypassed; // AND or OR nodes with a single child left
+    long children_merged; // children merged into a parent of the same type
+    long unreferenced_removed; // nodes no longer reachable
+    std::vector<ConditionStep> condition_steps;
+
+    DDNNFStats();
+    void add_phase(const std::string& name, double milliseconds);
+    // adds the timings, counters and steps of other, except its phases
+    void add(const DDNNFStats& other);
+    long nodes_deleted()const;
+    // allocations is -1 when they were not counted
+    void write_json(std::ostream& out, long peak_rss_kb, long allocations)const;
+};
+
+// Adds the time until its destruction to *total, does nothing if total is null
+class PhaseTimer{
+    private:
+    double* total;
+    std::chrono::high_resolution_clock::time_point start;
+
+    public:
+    PhaseTimer(double* total);
+    PhaseTimer(const PhaseTimer& other) = delete;
+    PhaseTimer& operator=(const PhaseTimer& other) = delete;
+    ~PhaseTimer();
+};
+
+#endif
@@ -0,0 +1,528 @@
+#include "stream.h"
+#include "error.h"
+#include <iostream>
+#include <cstdlib>
+#include <zlib.h>
+#ifdef DDNNF_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+BlockQueue::BlockQueue(size_t capacity){
+    this->capacity = capacity < 1 ? 1 : capacity;
+    closed = false;
+}
+
+bool BlockQueue::push(std::vector<char>& block){
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard,[&](){return closed || blocks.size() < capacity;});
+    if(closed){return false;}
+    blocks.push_back(std::vector<char>());
+    blocks.back().swap(block);
+    changed.notify_all();
+    return true;
+}
+
+bool BlockQueue::pop(std::vector<char>& block){
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard,[&](){return closed || !blocks.empty();});
+    if(blocks.empty()){return false;}
+    block.swap(blocks.front());
+    blocks.pop_front();
+    changed.notify_all();
+    return true;
+}
+
+void BlockQueue::close(){
+    std::lock_guard<std::mutex> guard(lock);
+    closed = true;
+    changed.notify_all();
+}
+
+ReadAheadBuffer::ReadAheadBuffer(std::streambuf* source, size_t block_size, int depth): queue(depth){
+    this->source = source;
+    this->block_size = block_size;
+    current = std::vector<char>();
+    setg(nullptr,nullptr,nullptr);
+    reader = std::thread(&ReadAheadBuffer::read_loop,this);
+}
+
+ReadAheadBuffer::~ReadAheadBuffer(){
+    // stops the reader if the consumer gave up early
+    queue.close();
+    reader.join();
+}
+
+void ReadAheadBuffer::read_loop(){
+    // with errors_throw(true) decompression errors are exceptions, which
+    // must not escape the thread: they are handed to the consumer
+    try{
+        while(true){
+            std::vector<char> block = std::vector<char>(block_size);
+            std::streamsize count = source->sgetn(block.data(),block_size);
+            if(count <= 0){break;}
+            block.resize(count);
+            if(!queue.push(block)){return;}
+        }
+    }catch(...){
+        error = std::current_exception();
+    }
+    // blocks already queued can still be popped
+    queue.close();
+}
+
+ReadAheadBuffer::int_type ReadAheadBuffer::underflow(){
+    if(gptr() < egptr()){
+        return traits_type::to_int_type(*gptr());
+    }
+    if(!queue.pop(current)){
+        // the queue was closed after error was set
+        if(error){std::rethrow_exception(error);}
+        return traits_type::eof();
+    }
+    setg(current.data(),current.data(),current.data() + current.size());
+    return traits_type::to_int_type(*gptr());
+}
+
+WriteBehindBuffer::WriteBehindBuffer(std::streambuf* target, size_t block_size, int depth): queue(depth){
+    this->target = target;
+    this->block_size = block_size < 1 ? 1 : block_size;
+    write_failed = false;
+    closed = false;
+    current = std::vector<char>(this->block_size);
+    setp(current.data(),current.data() + current.size());
+    writer = std::thread(&WriteBehindBuffer::write_loop,this);
+}
+
+WriteBehindBuffer::~WriteBehindBuffer(){
+    // only reached without close when unwinding from another error
+    try{
+        close();
+    }catch(...){}
+}
+
+void WriteBehindBuffer::write_loop(){
+    std::vector<char> block = std::vector<char>();
+    try{
+        while(queue.pop(block)){
+            std::streamsize count = block.size();
+            if(!write_failed && target->sputn(block.data(),count) != count){
+                write_failed = true;
+            }
+        }
+    }catch(...){
+        // compression errors are rethrown by close, closing the queue
+        // keeps the producer from waiting for a writer that is gone
+        error = std::current_exception();
+        write_failed = true;
+        queue.close();
+    }
+}
+
+void WriteBehindBuffer::hand_over(){
+    size_t used = pptr() - pbase();
+    if(used > 0){
+        current.resize(used);
+        queue.push(current);
+        current = std::vector<char>(block_size);
+    }
+    setp(current.data(),current.data() + current.size());
+}
+
+WriteBehindBuffer::int_type WriteBehindBuffer::overflow(int_type c){
+    if(closed){return traits_type::eof();}
+    hand_over();
+    if(!traits_type::eq_int_type(c,traits_type::eof())){
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int WriteBehindBuffer::sync(){
+    // the block is written in the background, sync does not wait for it
+    if(closed){return -1;}
+    hand_over();
+    return 0;
+}
+
+bool WriteBehindBuffer::close(){
+    if(!closed){
+        hand_over();
+        closed = true;
+        queue.close();
+        writer.join();
+        setp(nullptr,nullptr);
+        if(error){std::rethrow_exception(error);}
+        if(target->pubsync() != 0){
+            write_failed = true;
+        }
+    }
+    return !write_failed;
+}
+
+// compressed data is read and written in blocks of this size
+const size_t COMPRESSION_BLOCK_SIZE = 1 << 18;
+// background decompression and compression keep this many blocks queued
+const size_t BACKGROUND_BLOCK_SIZE = 1 << 20;
+const int BACKGROUND_DEPTH = 8;
+
+bool ends_with(const std::string& text, const std::string& suffix){
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(),suffix.size(),suffix) == 0;
+}
+
+bool is_standard_stream(const std::string& filename){
+    return filename == "-";
+}
+
+compression_format compression_from_extension(const std::string& filename){
+    if(ends_with(filename,".gz")){return GZIP_COMPRESSION;}
+    if(ends_with(filename,".zst") || ends_with(filename,".zstd")){return ZSTD_COMPRESSION;}
+    return NO_COMPRESSION;
+}
+
+compression_format compression_from_name(const std::string& name){
+    if(name == "gzip"){return GZIP_COMPRESSION;}
+    if(name == "zstd"){return ZSTD_COMPRESSION;}
+    if(name == "none"){return NO_COMPRESSION;}
+    fail(std::string("Unknown compression ") + name);
+}
+
+compression_format compression_from_magic(const unsigned char* bytes, size_t count){
+    if(count >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b){return GZIP_COMPRESSION;}
+    if(count >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd){return ZSTD_COMPRESSION;}
+    return NO_COMPRESSION;
+}
+
+compression_format detect_compression(const std::string& filename){
+    if(is_standard_stream(filename)){
+        // cannot look ahead without consuming the input
+        return NO_COMPRESSION;
+    }
+    std::ifstream file(filename,std::ios::binary);
+    unsigned char bytes[4];
+    file.read((char*)bytes,4);
+    return compression_from_magic(bytes,file.gcount());
+}
+
+void print_compression_error(const std::string& error){
+    fail(error);
+}
+
+void check_zstd_support(){
+#ifndef DDNNF_WITH_ZSTD
+    print_compression_error("zstd support is not compiled in, rebuild with make ZSTD=1");
+#endif
+}
+
+DecompressingBuffer::DecompressingBuffer(std::streambuf* source){
+    this->source = source;
+    input = std::vector<char>(COMPRESSION_BLOCK_SIZE);
+    input_begin = 0;
+    input_end = 0;
+    source_done = false;
+    frame_done = false;
+    gzip_stream = nullptr;
+    zstd_stream = nullptr;
+    setg(nullptr,nullptr,nullptr);
+    // pipes may deliver fewer bytes than asked, the magic needs four
+    while(input_end < 4 && refill()){}
+    format = compression_from_magic((const unsigned char*)input.data(),input_end);
+    if(format == GZIP_COMPRESSION){
+        output = std::vector<char>(COMPRESSION_BLOCK_SIZE);
+        gzip_stream = new z_stream();
+        // 32 lets zlib accept both gzip and zlib headers
+        if(inflateInit2(gzip_stream,15 + 32) != Z_OK){
+            print_compression_error("Unable to initialize gzip decompression");
+        }
+    }else if(format == ZSTD_COMPRESSION){
+        check_zstd_support();
+#ifdef DDNNF_WITH_ZSTD
+        output = std::vector<char>(ZSTD_DStreamOutSize());
+        zstd_stream = ZSTD_createDStream();
+        if(zstd_stream == nullptr || ZSTD_isError(ZSTD_initDStream(zstd_stream))){
+            print_compression_error("Unable to initialize zstd decompression");
+        }
+#endif
+    }
+}
+
+DecompressingBuffer::~DecompressingBuffer(){
+    if(gzip_stream != nullptr){
+        inflateEnd(gzip_stream);
+        delete gzip_stream;
+    }
+#ifdef DDNNF_WITH_ZSTD
+    if(zstd_stream != nullptr){
+        ZSTD_freeDStream(zstd_stream);
+    }
+#endif
+}
+
+compression_format DecompressingBuffer::get_format()const{
+    return format;
+}
+
+bool DecompressingBuffer::refill(){
+    // appends to the unread input, returns false at the end of the source
+    if(source_done){return false;}
+    if(input_begin == input_end){
+        input_begin = 0;
+        input_end = 0;
+    }
+    if(input_end == input.size()){return true;}
+    std::streamsize count = source->sgetn(input.data() + input_end,input.size() - input_end);
+    if(count <= 0){
+        source_done = true;
+        return false;
+    }
+    input_end += count;
+    return true;
+}
+
+size_t DecompressingBuffer::decompress(){
+    // consumes some input, returns the number of bytes written to output
+    if(format == GZIP_COMPRESSION){
+        if(frame_done){
+            // concatenated gzip members form a single file
+            inflateReset(gzip_stream);
+            frame_done = false;
+        }
+        gzip_stream->next_in = (Bytef*)input.data() + input_begin;
+        gzip_stream->avail_in = input_end - input_begin;
+        gzip_stream->next_out = (Bytef*)output.data();
+        gzip_stream->avail_out = output.size();
+        int status = inflate(gzip_stream,Z_NO_FLUSH);
+        if(status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR){
+            print_compression_error("Corrupted gzip input");
+        }
+        frame_done = status == Z_STREAM_END;
+        input_begin = input_end - gzip_stream->avail_in;
+        return output.size() - gzip_stream->avail_out;
+    }
+#ifdef DDNNF_WITH_ZSTD
+    ZSTD_inBuffer in = {input.data() + input_begin,input_end - input_begin,0};
+    ZSTD_outBuffer out = {output.data(),output.size(),0};
+    size_t status = ZSTD_decompressStream(zstd_stream,&out,&in);
+    if(ZSTD_isError(status)){
+        print_compression_error("Corrupted zstd input");
+    }
+    // 0 means a frame was completed and flushed
+    frame_done = status == 0;
+    input_begin += in.pos;
+    return out.pos;
+#else
+    return 0;
+#endif
+}
+
+DecompressingBuffer::int_type DecompressingBuffer::underflow(){
+    if(gptr() < egptr()){
+        return traits_type::to_int_type(*gptr());
+    }
+    if(format == NO_COMPRESSION){
+        // hand out the input buffer itself
+        if(input_begin == input_end && !refill()){
+            return traits_type::eof();
+        }
+        setg(input.data() + input_begin,input.data() + input_begin,input.data() + input_end);
+        input_begin = input_end;
+        return traits_type::to_int_type(*gptr());
+    }
+    while(true){
+        if(input_begin == input_end && !refill()){
+            if(!frame_done){
+                print_compression_error("Truncated compressed input");
+            }
+            return traits_type::eof();
+        }
+        size_t produced = decompress();
+        if(produced > 0){
+            setg(output.data(),output.data(),output.data() + produced);
+            return traits_type::to_int_type(*gptr());
+        }
+    }
+}
+
+CompressingBuffer::CompressingBuffer(std::streambuf* target, compression_format format){
+    this->target = target;
+    this->format = format;
+    pending = std::vector<char>(COMPRESSION_BLOCK_SIZE);
+    output = std::vector<char>(COMPRESSION_BLOCK_SIZE);
+    gzip_stream = nullptr;
+    zstd_stream = nullptr;
+    write_failed = false;
+    closed = false;
+    if(format == GZIP_COMPRESSION){
+        gzip_stream = new z_stream();
+        // 16 asks zlib for a gzip header instead of a zlib one
+        if(deflateInit2(gzip_stream,Z_DEFAULT_COMPRESSION,Z_DEFLATED,15 + 16,8,Z_DEFAULT_STRATEGY) != Z_OK){
+            print_compression_error("Unable to initialize gzip compression");
+        }
+    }else if(format == ZSTD_COMPRESSION){
+        check_zstd_support();
+#ifdef DDNNF_WITH_ZSTD
+        output = std::vector<char>(ZSTD_CStreamOutSize());
+        zstd_stream = ZSTD_createCCtx();
+        if(zstd_stream == nullptr){
+            print_compression_error("Unable to initialize zstd compression");
+        }
+#endif
+    }
+    setp(pending.data(),pending.data() + pending.size());
+}
+
+CompressingBuffer::~CompressingBuffer(){
+    // only releases the compressor, the stream is ended by close
+    if(gzip_stream != nullptr){
+        deflateEnd(gzip_stream);
+        delete gzip_stream;
+    }
+#ifdef DDNNF_WITH_ZSTD
+    if(zstd_stream != nullptr){
+        ZSTD_freeCCtx(zstd_stream);
+    }
+#endif
+}
+
+void CompressingBuffer::compress(bool finish){
+    // compresses the pending bytes and writes the result to target
+    size_t count = pptr() - pbase();
+    if(format == GZIP_COMPRESSION){
+        gzip_stream->next_in = (Bytef*)pbase();
+        gzip_stream->avail_in = count;
+        int status;
+        do{
+            gzip_stream->next_out = (Bytef*)output.data();
+            gzip_stream->avail_out = output.size();
+            status = deflate(gzip_stream,finish ? Z_FINISH : Z_NO_FLUSH);
+            std::streamsize produced = output.size() - gzip_stream->avail_out;
+            if(produced > 0 && target->sputn(output.data(),produced) != produced){
+                write_failed = true;
+            }
+        }while(gzip_stream->avail_out == 0 || (finish && status != Z_STREAM_END));
+    }else if(format == ZSTD_COMPRESSION){
+#ifdef DDNNF_WITH_ZSTD
+        ZSTD_inBuffer in = {pbase(),count,0};
+        size_t remaining;
+        do{
+            ZSTD_outBuffer out = {output.data(),output.size(),0};
+            remaining = ZSTD_compressStream2(zstd_stream,&out,&in,finish ? ZSTD_e_end : ZSTD_e_continue);
+            if(ZSTD_isError(remaining)){
+                print_compression_error("zstd compression failed");
+            }
+            std::streamsize produced = out.pos;
+            if(produced > 0 && target->sputn(output.data(),produced) != produced){
+                write_failed = true;
+            }
+        }while(finish ? remaining != 0 : in.pos < in.size);
+#endif
+    }else if(count > 0 && target->sputn(pbase(),count) != (std::streamsize)count){
+        write_failed = true;
+    }
+    setp(pending.data(),pending.data() + pending.size());
+}
+
+CompressingBuffer::int_type CompressingBuffer::overflow(int_type c){
+    if(closed){return traits_type::eof();}
+    compress(false);
+    if(!traits_type::eq_int_type(c,traits_type::eof())){
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int CompressingBuffer::sync(){
+    // flushing the compressor would hurt the ratio, bytes stay pending
+    return closed ? -1 : 0;
+}
+
+bool CompressingBuffer::close(){
+    if(!closed){
+        compress(true);
+        closed = true;
+        setp(nullptr,nullptr);
+        if(target->pubsync() != 0){
+            write_failed = true;
+        }
+    }
+    return !write_failed;
+}
+
+InputFile::InputFile(const std::string& filename, bool read_ahead): in(nullptr){
+    this->filename = filename;
+    std::streambuf* source = std::cin.rdbuf();
+    if(!is_standard_stream(filename)){
+        file.open(filename,std::ios::binary);
+        if(!file){
+            fail(std::string("Unable to open file ") + filename);
+        }
+        source = file.rdbuf();
+    }
+    // compression is recognized on the data itself, so pipes work too
+    decompressor = std::unique_ptr<DecompressingBuffer>(new DecompressingBuffer(source));
+    std::streambuf* buffer = decompressor.get();
+    if(read_ahead || decompressor->get_format() != NO_COMPRESSION){
+        this->read_ahead = std::unique_ptr<ReadAheadBuffer>(new ReadAheadBuffer(buffer,BACKGROUND_BLOCK_SIZE,BACKGROUND_DEPTH));
+        buffer = this->read_ahead.get();
+    }
+    in.rdbuf(buffer);
+    // streams swallow the exceptions of their buffers unless asked,
+    // errors of the buffers above then reach the caller unchanged
+    in.exceptions(std::ios::badbit);
+}
+
+std::istream& InputFile::stream(){
+    return in;
+}
+
+OutputFile::OutputFile(const std::string& filename, compression_format compression, bool write_behind): out(nullptr){
+    this->filename = filename;
+    closed = false;
+    std::streambuf* buffer = std::cout.rdbuf();
+    if(is_standard_stream(filename)){
+        // standard output is written in large blocks
+        write_behind = true;
+    }else{
+        file.open(filename,std::ios::binary);
+        if(!file){
+            fail(std::string("Unable to open file ") + filename);
+        }
+        buffer = file.rdbuf();
+    }
+    if(compression != NO_COMPRESSION){
+        compressor = std::unique_ptr<CompressingBuffer>(new CompressingBuffer(buffer,compression));
+        buffer = compressor.get();
+    }
+    if(write_behind || compression != NO_COMPRESSION){
+        this->write_behind = std::unique_ptr<WriteBehindBuffer>(new WriteBehindBuffer(buffer,BACKGROUND_BLOCK_SIZE,BACKGROUND_DEPTH));
+        buffer = this->write_behind.get();
+    }
+    out.rdbuf(buffer);
+}
+
+OutputFile::~OutputFile(){
+    // without close the file is left unfinished, this is only reached
+    // when unwinding from another error, and the buffers are released
+    // without reporting theirs
+}
+
+std::ostream& OutputFile::stream(){
+    return out;
+}
+
+void OutputFile::close(){
+    if(closed){return;}
+    closed = true;
+    out.flush();
+    bool written = !out.fail();
+    if(write_behind && !write_behind->close()){written = false;}
+    if(compressor && !compressor->close()){written = false;}
+    if(file.is_open()){
+        file.close();
+        if(file.fail()){written = false;}
+    }
+    if(!written){
+        fail(std::string("Unable to write file ") + filename);
+    }
+}
@@ -0,0 +1,192 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <vector>
+#include <deque>
+#include <streambuf>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <fstream>
+#include <memory>
+#include <exception>
+
+// compression libraries, only used by stream.cpp
+struct z_stream_s;
+struct ZSTD_DCtx_s;
+struct ZSTD_CCtx_s;
+
+enum compression_format {
+    NO_COMPRESSION,
+    GZIP_COMPRESSION,
+    ZSTD_COMPRESSION
+};
+
+// "-" stands for standard input or standard output
+bool is_standard_stream(const std::string& filename);
+// .gz and .zst files are compressed, anything else is not
+compression_format compression_from_extension(const std::string& filename);
+// "gzip", "zstd" or "none", exits on other names
+compression_format compression_from_name(const std::string& name);
+// looks at the magic bytes at the start of the file
+compression_format detect_compression(const std::string& filename);
+
+// Bounded queue of byte blocks handed from one thread to another,
+// push blocks while the queue is full
+class BlockQueue{
+    private:
+    std::deque<std::vector<char>> blocks;
+    size_t capacity;
+    bool closed;
+    std::mutex lock;
+    std::condition_variable changed;
+
+    public:
+    BlockQueue(size_t capacity);
+    bool push(std::vector<char>& block); // false once closed, takes the block contents
+    bool pop(std::vector<char>& block); // false once closed and empty
+    void close(); // wakes up both sides
+};
+
+// Input buffer filled by a background thread reading ahead from
+// source, so that the consumer parses while the next blocks are read
+class ReadAheadBuffer: public std::streambuf{
+    private:
+    std::streambuf* source;
+    size_t block_size;
+    BlockQueue queue;
+    std::vector<char> current;
+    std::thread reader;
+    // error raised by the reader, rethrown to the consumer once the
+    // blocks read before it are used up
+    std::exception_ptr error;
+    void read_loop();
+
+    protected:
+    int_type underflow();
+
+    public:
+    ReadAheadBuffer(std::streambuf* source, size_t block_size, int depth);
+    ReadAheadBuffer(const ReadAheadBuffer& other) = delete;
+    ReadAheadBuffer& operator=(const ReadAheadBuffer& other) = delete;
+    ~ReadAheadBuffer();
+};
+
+// Output buffer whose full blocks are written to target by a
+// background thread, so that formatting overlaps the writes
+class WriteBehindBuffer: public std::streambuf{
+    private:
+    std::streambuf* target;
+    size_t block_size;
+    BlockQueue queue;
+    std::vector<char> current;
+    std::thread writer;
+    bool write_failed; // only touched by the writer until it is joined
+    std::exception_ptr error; // error raised by the writer, rethrown by close
+    bool closed;
+    void write_loop();
+    void hand_over(); // queues the bytes written so far
+
+    protected:
+    int_type overflow(int_type c);
+    int sync();
+
+    public:
+    WriteBehindBuffer(std::streambuf* target, size_t block_size, int depth);
+    WriteBehindBuffer(const WriteBehindBuffer& other) = delete;
+    WriteBehindBuffer& operator=(const WriteBehindBuffer& other) = delete;
+    ~WriteBehindBuffer();
+    // writes all pending blocks, returns false if any write failed
+    // and rethrows the error of the writer if it raised one
+    bool close();
+};
+
+// Input buffer that recognizes gzip and zstd data by its magic bytes
+// and decompresses it on the fly, other data is passed through
+class DecompressingBuffer: public std::streambuf{
+    private:
+    std::streambuf* source;
+    compression_format format;
+    std::vector<char> input;
+    size_t input_begin; // unread input is [input_begin,input_end)
+    size_t input_end;
+    bool source_done;
+    bool frame_done; // the last compressed frame was complete
+    std::vector<char> output;
+    z_stream_s* gzip_stream;
+    ZSTD_DCtx_s* zstd_stream;
+    bool refill();
+    size_t decompress();
+
+    protected:
+    int_type underflow();
+
+    public:
+    DecompressingBuffer(std::streambuf* source);
+    DecompressingBuffer(const DecompressingBuffer& other) = delete;
+    DecompressingBuffer& operator=(const DecompressingBuffer& other) = delete;
+    ~DecompressingBuffer();
+    compression_format get_format()const;
+};
+
+// Output buffer compressing everything written to it into target
+class CompressingBuffer: public std::streambuf{
+    private:
+    std::streambuf* target;
+    compression_format format;
+    std::vector<char> pending;
+    std::vector<char> output;
+    z_stream_s* gzip_stream;
+    ZSTD_CCtx_s* zstd_stream;
+    bool write_failed;
+    bool closed;
+    void compress(bool finish);
+
+    protected:
+    int_type overflow(int_type c);
+    int sync();
+
+    public:
+    CompressingBuffer(std::streambuf* target, compression_format format);
+    CompressingBuffer(const CompressingBuffer& other) = delete;
+    CompressingBuffer& operator=(const CompressingBuffer& other) = delete;
+    ~CompressingBuffer(); // does not end the stream
+    // ends the compressed stream, returns false if any write failed
+    bool close();
+};
+
+// Circuit file opened for reading: compressed files are decompressed
+// by a background thread, which can also read ahead plain files
+class InputFile{
+    private:
+    std::string filename;
+    std::ifstream file;
+    std::unique_ptr<DecompressingBuffer> decompressor;
+    std::unique_ptr<ReadAheadBuffer> read_ahead;
+    std::istream in;
+
+    public:
+    InputFile(const std::string& filename, bool read_ahead); // exits if the file cannot be opened
+    std::istream& stream();
+};
+
+// Circuit file opened for writing: compression always runs on a
+// background thread, which can also write behind plain files
+class OutputFile{
+    private:
+    std::string filename;
+    std::ofstream file;
+    std::unique_ptr<CompressingBuffer> compressor;
+    std::unique_ptr<WriteBehindBuffer> write_behind;
+    std::ostream out;
+    bool closed;
+
+    public:
+    OutputFile(const std::string& filename, compression_format compression, bool write_behind); // exits if the file cannot be created
+    ~OutputFile(); // never fails, the file is only finished by close
+    std::ostream& stream();
+    void close(); // exits if the file could not be written
+};
+
+#endif
@@ -0,0 +1,377 @@
+#include "tape.h"
+#include "error.h"
+#include "modular.h"
+#include "parallel.h"
+#include <fstream>
+#include <cstring>
+
+const char TAPE_MAGIC[8] = {'D','D','N','N','F','T','A','P'};
+// slots 0 and 1 hold the constants
+const uint32_t TAPE_FALSE_SLOT = 0;
+const uint32_t TAPE_TRUE_SLOT = 1;
+const uint32_t TAPE_LITERAL_SLOT = 2;
+
+// layout of tape files: header, literals, instructions, operands
+struct TapeHeader{
+    char magic[8]; // "DDNNFTAP"
+    uint64_t total_variables;
+    uint64_t literal_count;
+    uint64_t instruction_count;
+    uint64_t operand_count;
+    uint64_t root;
+};
+
+void print_tape_error(){
+    fail("File is not an evaluation tape");
+}
+
+EvaluationTape::EvaluationTape(){
+    total_variables = 0;
+    root = TAPE_FALSE_SLOT;
+}
+
+EvaluationTape::EvaluationTape(const DDNNF& ddnnf){
+    total_variables = ddnnf.get_total_variables();
+    long node_count = ddnnf.node_count();
+    if(node_count == 0){
+        root = TAPE_FALSE_SLOT;
+        return;
+    }
+    std::vector<uint32_t> slots = std::vector<uint32_t>(node_count,TAPE_FALSE_SLOT);
+    // literal leaves first, sorted so that their slots are filled in one pass
+    std::vector<std::pair<int,int>> leaves = std::vector<std::pair<int,int>>();
+    for(int id = 0; id < node_count; id++){
+        const DDNNFNode* node = ddnnf.get_node(id);
+        if(node->is_literal()){
+            leaves.push_back(std::make_pair(node->get_var(),id));
+        }
+    }
+    std::sort(leaves.begin(),leaves.end());
+    for(auto& leaf: leaves){
+        slots[leaf.second] = TAPE_LITERAL_SLOT + literals.size();
+        literals.push_back(leaf.first);
+    }
+    // nodes are stored children first, so are the instructions
+    uint32_t next_slot = TAPE_LITERAL_SLOT + literals.size();
+    for(int id = 0; id < node_count; id++){
+        const DDNNFNode* node = ddnnf.get_node(id);
+        switch(node->get_type()){
+            case DDNNF_TRUE: slots[id] = TAPE_TRUE_SLOT; break;
+            case DDNNF_FALSE: slots[id] = TAPE_FALSE_SLOT; break;
+            case DDNNF_LITERAL: break;
+            case DDNNF_AND:
+            case DDNNF_OR:{
+                TapeInstruction instruction;
+                instruction.op = node->get_type() == DDNNF_AND ? TAPE_AND : TAPE_OR;
+                instruction.first = operands.size();
+                instruction.count = node->get_children().size();
+                for(int child: node->get_children()){
+                    operands.push_back(slots[child]);
+                }
+                instructions.push_back(instruction);
+                slots[id] = next_slot++;
+            }break;
+        }
+    }
+    root = slots[ddnnf.get_root_id()];
+}
+
+void EvaluationTape::save(const char* filename)const{
+    std::ofstream out(filename,std::ios::binary);
+    if(!out){
+        fail(std::string("Unable to open file ") + filename);
+    }
+    TapeHeader header;
+    memcpy(header.magic,TAPE_MAGIC,sizeof(TAPE_MAGIC));
+    header.total_variables = total_variables;
+    header.literal_count = literals.size();
+    header.instruction_count = instructions.size();
+    header.operand_count = operands.size();
+    header.root = root;
+    out.write((const char*)&header,sizeof(header));
+    out.write((const char*)literals.data(),literals.size() * sizeof(int32_t));
+    out.write((const char*)instructions.data(),instructions.size() * sizeof(TapeInstruction));
+    out.write((const char*)operands.data(),operands.size() * sizeof(uint32_t));
+    out.close();
+    if(out.fail()){
+        fail(std::string("Unable to write file ") + filename);
+    }
+}
+
+void EvaluationTape::load(const char* filename){
+    std::ifstream in(filename,std::ios::binary);
+    if(!in){
+        fail(std::string("Unable to open file ") + filename);
+    }
+    TapeHeader header;
+    if(!in.read((char*)&header,sizeof(header)) || memcmp(header.magic,TAPE_MAGIC,sizeof(TAPE_MAGIC)) != 0){
+        print_tape_error();
+    }
+    // sizes are checked against the file before anything is allocated
+    in.seekg(0,std::ios::end);
+    uint64_t file_size = in.tellg();
+    in.seekg(sizeof(header),std::ios::beg);
+    if(header.total_variables > INT32_MAX || header.literal_count > file_size || header.instruction_count > file_size || header.operand_count > file_size){
+        print_tape_error();
+    }
+    if(sizeof(header) + header.literal_count * sizeof(int32_t) + header.instruction_count * sizeof(TapeInstruction) + header.operand_count * sizeof(uint32_t) != file_size){
+        print_tape_error();
+    }
+    total_variables = header.total_variables;
+    literals = std::vector<int32_t>(header.literal_count);
+    instructions = std::vector<TapeInstruction>(header.instruction_count);
+    operands = std::vector<uint32_t>(header.operand_count);
+    in.read((char*)literals.data(),literals.size() * sizeof(int32_t));
+    in.read((char*)instructions.data(),instructions.size() * sizeof(TapeInstruction));
+    in.read((char*)operands.data(),operands.size() * sizeof(uint32_t));
+    if(!in){print_tape_error();}
+    root = header.root;
+    // every slot is read after it is written, and every literal is valid
+    for(int32_t literal: literals){
+        if(literal == 0 || abs(literal) > total_variables){print_tape_error();}
+    }
+    uint64_t slot = first_instruction_slot();
+    for(const TapeInstruction& instruction: instructions){
+        if(instruction.op > TAPE_OR || (uint64_t)instruction.first + instruction.count > operands.size()){print_tape_error();}
+        for(uint32_t i = 0; i < instruction.count; i++){
+            if(operands[instruction.first + i] >= slot){print_tape_error();}
+        }
+        slot++;
+    }
+    if(root >= slot_count()){print_tape_error();}
+}
+
+int EvaluationTape::get_total_variables()const{
+    return total_variables;
+}
+
+size_t EvaluationTape::slot_count()const{
+    return first_instruction_slot() + instructions.size();
+}
+
+size_t EvaluationTape::instruction_count()const{
+    return instructions.size();
+}
+
+size_t EvaluationTape::first_instruction_slot()const{
+    return TAPE_LITERAL_SLOT + literals.size();
+}
+
+template<typename T, typename Leaf, typename And, typename Or>
+T EvaluationTape::run(std::vector<T>& values, T false_value, T true_value, const Leaf& leaf, const And& conjoin, const Or& disjoin)const{
+    values.resize(slot_count());
+    values[TAPE_FALSE_SLOT] = false_value;
+    values[TAPE_TRUE_SLOT] = true_value;
+    for(size_t i = 0; i < literals.size(); i++){
+        values[TAPE_LITERAL_SLOT + i] = leaf(literals[i]);
+    }
+    T* slot = values.data() + first_instruction_slot();
+    const uint32_t* operand_data = operands.data();
+    for(const TapeInstruction& instruction: instructions){
+        const uint32_t* operand = operand_data + instruction.first;
+        const uint32_t* operand_end = operand + instruction.count;
+        T value;
+        if(instruction.op == TAPE_AND){
+            value = true_value;
+            for(; operand != operand_end; operand++){value = conjoin(value,values[*operand]);}
+        }else{
+            value = false_value;
+            for(; operand != operand_end; operand++){value = disjoin(value,values[*operand]);}
+        }
+        *slot++ = value;
+    }
+    return values[root];
+}
+
+uint64_t EvaluationTape::weighted_count_mod(const std::vector<uint64_t>& weights, uint64_t prime)const{
+    // as DDNNF::weighted_count_mod, literal -v gets 1 - weights[v]
+    for(int32_t literal: literals){
+        if(abs(literal) >= (int)weights.size()){
+            fail(std::string("Missing weight for variable ") + std::to_string(abs(literal)));
+        }
+    }
+    std::vector<uint64_t> values;
+    uint64_t one = 1 % prime;
+    return run<uint64_t>(values,0,one,[&](int32_t literal){
+        uint64_t weight = weights[abs(literal)] % prime;
+        return literal > 0 ? weight : mod_sub(one,weight,prime);
+    },[&](uint64_t a, uint64_t b){return mod_mul(a,b,prime);},[&](uint64_t a, uint64_t b){return mod_add(a,b,prime);});
+}
+
+uint64_t EvaluationTape::model_count_mod(uint64_t prime)const{
+    // weights 1/2 for both literals of every variable give the fraction
+    // of assignments that are models, no smoothing needed (prime is odd)
+    uint64_t half = mod_inv(2 % prime,prime);
+    std::vector<uint64_t> values;
+    uint64_t fraction = run<uint64_t>(values,0,1 % prime,[&](int32_t){return half;},
+        [&](uint64_t a, uint64_t b){return mod_mul(a,b,prime);},[&](uint64_t a, uint64_t b){return mod_add(a,b,prime);});
+    return mod_mul(fraction,mod_pow(2 % prime,total_variables,prime),prime);
+}
+
+BigInt EvaluationTape::model_count(int bit_bound, int threads)const{
+    // same primes as DDNNF::model_count, one residue each
+    if(bit_bound <= 0 || bit_bound > total_variables + 1){
+        bit_bound = total_variables + 1;
+    }
+    int prime_count = bit_bound / (MODULAR_PRIME_BITS - 1) + 1;
+    std::vector<uint64_t> primes = find_primes(prime_count);
+    std::vector<uint64_t> residues = std::vector<uint64_t>(prime_count);
+    parallel_for(prime_count,threads,[&](int prime_index){
+        residues[prime_index] = model_count_mod(primes[prime_index]);
+    });
+    return crt_reconstruct(residues,primes);
+}
+
+uint64_t EvaluationTape::consistent_lanes(const std::vector<std::vector<int>>& terms, size_t first, std::vector<uint64_t>& values)const{
+    // falsified[l + total_variables] has the lanes whose term contains -l
+    std::vector<uint64_t> falsified = std::vector<uint64_t>(2 * total_variables + 1,0);
+    uint64_t contradictory = 0;
+    size_t last = std::min(terms.size(),first + 64);
+    for(size_t t = first; t < last; t++){
+        uint64_t bit = 1ULL << (t - first);
+        // variables outside the circuit are unconstrained, unless
+        // the term has both of their literals
+        std::set<int> outside = std::set<int>();
+        for(int literal: terms[t]){
+            if(abs(literal) > total_variables){
+                if(outside.count(-literal) > 0){contradictory |= bit;}
+                outside.insert(literal);
+                continue;
+            }
+            falsified[total_variables - literal] |= bit;
+        }
+    }
+    for(int var = 1; var <= total_variables; var++){
+        contradictory |= falsified[total_variables + var] & falsified[total_variables - var];
+    }
+    uint64_t root_value = run<uint64_t>(values,0,~0ULL,[&](int32_t literal){return ~falsified[total_variables + literal];},
+        [](uint64_t a, uint64_t b){return a & b;},[](uint64_t a, uint64_t b){return a | b;});
+    // a term with complementary literals is never consistent
+    return root_value & ~contradictory;
+}
+
+std::vector<bool> EvaluationTape::are_consistent(const std::vector<std::vector<int>>& terms, int threads)const{
+    int batches = (terms.size() + 63) / 64;
+    std::vector<uint64_t> batch_results = std::vector<uint64_t>(batches);
+    parallel_for(batches,threads,[&](int batch){
+        std::vector<uint64_t> values;
+        batch_results[batch] = consistent_lanes(terms,(size_t)batch * 64,values);
+    });
+    std::vector<bool> results = std::vector<bool>(terms.size());
+    for(size_t t = 0; t < terms.size(); t++){
+        results[t] = (batch_results[t / 64] >> (t % 64)) & 1;
+    }
+    return results;
+}
+
+std::vector<bool> EvaluationTape::are_entailed(const std::vector<std::vector<int>>& clauses, int threads)const{
+    // as in DDNNF::are_entailed, through the negated clauses
+    std::vector<std::vector<int>> negated_clauses = std::vector<std::vector<int>>();
+    for(auto& clause: clauses){
+        std::vector<int> term = std::vector<int>();
+        for(int literal: clause){
+            term.push_back(-literal);
+        }
+        negated_clauses.push_back(term);
+    }
+    std::vector<bool> results = are_consistent(negated_clauses,threads);
+    for(size_t i = 0; i < results.size(); i++){
+        results[i] = !results[i];
+    }
+    return results;
+}
+
+// instructions per generated function, so that compilers do not
+// have to optimize a single function of millions of statements
+const size_t CPP_PART_SIZE = 256;
+
+void EvaluationTape::write_cpp(std::ostream& out)const{
+    size_t first_slot = first_instruction_slot();
+    size_t parts = (instructions.size() + CPP_PART_SIZE - 1) / CPP_PART_SIZE;
+    // operands as expressions: constants and literals are inlined,
+    // instruction results are read from the scratch array s
+    auto probability_operand = [&](uint32_t slot)->std::string{
+        if(slot == TAPE_FALSE_SLOT){return "0.0";}
+        if(slot == TAPE_TRUE_SLOT){return "1.0";}
+        if(slot < first_slot){
+            int literal = literals[slot - TAPE_LITERAL_SLOT];
+            return literal > 0 ? "w[" + std::to_string(literal) + "]" : "(1.0 - w[" + std::to_string(-literal) + "])";
+        }
+        return "s[" + std::to_string(slot - first_slot) + "]";
+    };
+    auto mod_operand = [&](uint32_t slot)->std::string{
+        if(slot == TAPE_FALSE_SLOT){return "0";}
+        if(slot == TAPE_TRUE_SLOT){return "one";}
+        if(slot < first_slot){
+            int literal = literals[slot - TAPE_LITERAL_SLOT];
+            return literal > 0 ? "w[" + std::to_string(literal) + "]" : "complement(w[" + std::to_string(-literal) + "],p)";
+        }
+        return "s[" + std::to_string(slot - first_slot) + "]";
+    };
+
+    out << "// Generated by ddnnf_condition -cpp: " << instructions.size() << " instructions over " << total_variables << " variables.\n";
+    out << "// Build with e.g. g++ -O2 -shared -fPIC, it exports with C linkage:\n";
+    out << "//   int ddnnf_variable_count()\n";
+    out << "//   size_t ddnnf_scratch_size(), entries of the scratch arrays\n";
+    out << "//   double ddnnf_probability(const double* w, double* scratch)\n";
+    out << "//     w[v] is the probability of v for v = 1..variables, -v gets 1 - w[v]\n";
+    out << "//   uint64_t ddnnf_weighted_count_mod(const uint64_t* w, uint64_t p, uint64_t* scratch)\n";
+    out << "//     same weights modulo the prime p < 2^62, already reduced modulo p\n";
+    out << "#include <cstdint>\n#include <cstddef>\n\n";
+    out << "static inline uint64_t add(uint64_t a, uint64_t b, uint64_t p){uint64_t r = a + b; return r >= p ? r - p : r;}\n";
+    // the 128 bit remainder is a library call anyway, inlining it only slows the build
+    out << "__attribute__((noinline)) static uint64_t mul(uint64_t a, uint64_t b, uint64_t p){return (unsigned __int128)a * b % p;}\n";
+    out << "static inline uint64_t complement(uint64_t a, uint64_t p){return a <= 1 ? 1 - a : p + 1 - a;}\n\n";
+    for(size_t part = 0; part < parts; part++){
+        size_t first = part * CPP_PART_SIZE;
+        size_t last = std::min(instructions.size(),first + CPP_PART_SIZE);
+        // AND and OR chains become a single product or sum
+        out << "static void probability_" << part << "(const double* w, double* s){\n";
+        for(size_t i = first; i < last; i++){
+            const TapeInstruction& instruction = instructions[i];
+            out << "    s[" << i << "] = ";
+            if(instruction.count == 0){
+                out << (instruction.op == TAPE_AND ? "1.0" : "0.0");
+            }
+            for(uint32_t k = 0; k < instruction.count; k++){
+                if(k > 0){out << (instruction.op == TAPE_AND ? " * " : " + ");}
+                out << probability_operand(operands[instruction.first + k]);
+            }
+            out << ";\n";
+        }
+        out << "}\n\n";
+        // modular chains are folded into the result slot one operand at a time
+        out << "static void count_mod_" << part << "(const uint64_t* w, uint64_t p, uint64_t one, uint64_t* s){\n";
+        for(size_t i = first; i < last; i++){
+            const TapeInstruction& instruction = instructions[i];
+            const char* op = instruction.op == TAPE_AND ? "mul" : "add";
+            out << "    s[" << i << "] = ";
+            if(instruction.count == 0){
+                out << (instruction.op == TAPE_AND ? "one" : "0") << ";\n";
+                continue;
+            }
+            out << mod_operand(operands[instruction.first]) << ";\n";
+            for(uint32_t k = 1; k < instruction.count; k++){
+                out << "    s[" << i << "] = " << op << "(s[" << i << "]," << mod_operand(operands[instruction.first + k]) << ",p);\n";
+            }
+        }
+        out << "}\n\n";
+    }
+    out << "extern \"C\" int ddnnf_variable_count(){return " << total_variables << ";}\n\n";
+    out << "extern \"C\" size_t ddnnf_scratch_size(){return " << std::max((size_t)1,instructions.size()) << ";}\n\n";
+    out << "extern \"C\" double ddnnf_probability(const double* w, double* scratch){\n";
+    for(size_t part = 0; part < parts; part++){
+        out << "    probability_" << part << "(w,scratch);\n";
+    }
+    out << "    double* s = scratch;\n";
+    out << "    return " << probability_operand(root) << ";\n";
+    out << "}\n\n";
+    out << "extern \"C\" uint64_t ddnnf_weighted_count_mod(const uint64_t* w, uint64_t p, uint64_t* scratch){\n";
+    out << "    uint64_t one = 1 % p;\n";
+    for(size_t part = 0; part < parts; part++){
+        out << "    count_mod_" << part << "(w,p,one,scratch);\n";
+    }
+    out << "    uint64_t* s = scratch;\n";
+    out << "    return " << mod_operand(root) << ";\n";
+    out << "}\n";
+}
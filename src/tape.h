@@ -0,0 +1,64 @@
+#ifndef __TAPE_H__
+#define __TAPE_H__
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "ddnnf.h"
+#include "bigint.h"
+
+// Flattened circuit for repeated evaluation: every node gets a slot in a
+// dense value array, laid out as
+//   slot 0 false, slot 1 true
+//   literal slots, sorted by literal and initialized in one loop
+//   one slot per AND/OR instruction, in tape order
+// instruction i writes slot first_instruction_slot() + i from the slots
+// operands[first, first + count), which always come before it
+enum tape_op : uint32_t {
+    TAPE_AND,
+    TAPE_OR
+};
+
+struct TapeInstruction{
+    uint32_t op; // a tape_op
+    uint32_t first; // first operand in operands
+    uint32_t count;
+};
+
+class EvaluationTape{
+    private:
+    int total_variables;
+    std::vector<int32_t> literals; // literal of each literal slot
+    std::vector<TapeInstruction> instructions;
+    std::vector<uint32_t> operands;
+    uint32_t root; // slot of the root
+
+    // fills values (one per slot) from the leaves and runs the instructions
+    template<typename T, typename Leaf, typename And, typename Or>
+    T run(std::vector<T>& values, T false_value, T true_value, const Leaf& leaf, const And& conjoin, const Or& disjoin)const;
+    // 64 terms at once, bit t of the result is set if term first + t is consistent
+    uint64_t consistent_lanes(const std::vector<std::vector<int>>& terms, size_t first, std::vector<uint64_t>& values)const;
+
+    public:
+    EvaluationTape();
+    // the circuit must be simplified, as it is after reading and every transformation
+    EvaluationTape(const DDNNF& ddnnf);
+    // serialization, exits if the file cannot be read or written
+    void save(const char* filename)const;
+    void load(const char* filename);
+    int get_total_variables()const;
+    size_t slot_count()const;
+    size_t instruction_count()const;
+    size_t first_instruction_slot()const;
+    // same results as the queries of DDNNF
+    uint64_t weighted_count_mod(const std::vector<uint64_t>& weights, uint64_t prime)const;
+    uint64_t model_count_mod(uint64_t prime)const;
+    BigInt model_count(int bit_bound, int threads)const;
+    std::vector<bool> are_consistent(const std::vector<std::vector<int>>& terms, int threads)const;
+    std::vector<bool> are_entailed(const std::vector<std::vector<int>>& clauses, int threads)const;
+    // writes a self-contained C++ source evaluating this tape as straight
+    // line code, see the comment at the top of the generated file
+    void write_cpp(std::ostream& out)const;
+};
+
+#endif
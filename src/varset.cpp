@@ -0,0 +1,138 @@
+#include "varset.h"
+
+VarSet::VarSet(){
+    word_ids = std::vector<uint32_t>();
+    words = std::vector<uint64_t>();
+    count = 0;
+}
+
+void VarSet::insert(int var){
+    uint32_t word_id = var >> 6;
+    uint64_t bit = 1ULL << (var & 63);
+    // find position of the word, keeping word ids sorted
+    size_t low = 0;
+    size_t high = word_ids.size();
+    while(low < high){
+        size_t middle = (low + high) / 2;
+        if(word_ids[middle] < word_id){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    if(low < word_ids.size() && word_ids[low] == word_id){
+        if((words[low] & bit) == 0){
+            words[low] |= bit;
+            count++;
+        }
+        return;
+    }
+    word_ids.insert(word_ids.begin() + low,word_id);
+    words.insert(words.begin() + low,bit);
+    count++;
+}
+
+bool VarSet::contains(int var)const{
+    uint32_t word_id = var >> 6;
+    size_t low = 0;
+    size_t high = word_ids.size();
+    while(low < high){
+        size_t middle = (low + high) / 2;
+        if(word_ids[middle] < word_id){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    if(low < word_ids.size() && word_ids[low] == word_id){
+        return (words[low] >> (var & 63)) & 1;
+    }
+    return false;
+}
+
+int VarSet::size()const{
+    return count;
+}
+
+bool VarSet::empty()const{
+    return count == 0;
+}
+
+void VarSet::unite(const VarSet& other){
+    if(other.word_ids.empty()){return;}
+    // merge the two sorted word lists
+    std::vector<uint32_t> new_word_ids = std::vector<uint32_t>();
+    std::vector<uint64_t> new_words = std::vector<uint64_t>();
+    new_word_ids.reserve(word_ids.size() + other.word_ids.size());
+    new_words.reserve(word_ids.size() + other.word_ids.size());
+    size_t i = 0;
+    size_t j = 0;
+    count = 0;
+    while(i < word_ids.size() || j < other.word_ids.size()){
+        if(j == other.word_ids.size() || (i < word_ids.size() && word_ids[i] < other.word_ids[j])){
+            new_word_ids.push_back(word_ids[i]);
+            new_words.push_back(words[i]);
+            i++;
+        }else if(i == word_ids.size() || other.word_ids[j] < word_ids[i]){
+            new_word_ids.push_back(other.word_ids[j]);
+            new_words.push_back(other.words[j]);
+            j++;
+        }else{
+            new_word_ids.push_back(word_ids[i]);
+            new_words.push_back(words[i] | other.words[j]);
+            i++;
+            j++;
+        }
+        count += __builtin_popcountll(new_words.back());
+    }
+    word_ids.swap(new_word_ids);
+    words.swap(new_words);
+}
+
+bool VarSet::intersects(const VarSet& other)const{
+    size_t i = 0;
+    size_t j = 0;
+    while(i < word_ids.size() && j < other.word_ids.size()){
+        if(word_ids[i] < other.word_ids[j]){
+            i++;
+        }else if(other.word_ids[j] < word_ids[i]){
+            j++;
+        }else{
+            if(words[i] & other.words[j]){return true;}
+            i++;
+            j++;
+        }
+    }
+    return false;
+}
+
+std::vector<int> VarSet::difference(const VarSet& other)const{
+    std::vector<int> result = std::vector<int>();
+    size_t j = 0;
+    for(size_t i = 0; i < word_ids.size(); i++){
+        while(j < other.word_ids.size() && other.word_ids[j] < word_ids[i]){
+            j++;
+        }
+        uint64_t word = words[i];
+        if(j < other.word_ids.size() && other.word_ids[j] == word_ids[i]){
+            word &= ~other.words[j];
+        }
+        while(word != 0){
+            int bit = __builtin_ctzll(word);
+            result.push_back((int)(word_ids[i] << 6) + bit);
+            word &= word - 1;
+        }
+    }
+    return result;
+}
+
+std::vector<int> VarSet::to_vector()const{
+    return difference(VarSet());
+}
+
+void VarSet::clear(){
+    // swap with empty vectors to release memory
+    std::vector<uint32_t>().swap(word_ids);
+    std::vector<uint64_t>().swap(words);
+    count = 0;
+}
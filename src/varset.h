@@ -0,0 +1,30 @@
+#ifndef __VARSET_H__
+#define __VARSET_H__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Set of variable indexes stored as a sorted list of
+// non empty 64 bit words: sets mentioning few variables
+// stay small even when the formula has many variables
+class VarSet{
+    private:
+    std::vector<uint32_t> word_ids; // sorted indexes of non empty words
+    std::vector<uint64_t> words; // bits of the words in word_ids
+    int count; // cached number of variables
+
+    public:
+    VarSet();
+    void insert(int var);
+    bool contains(int var)const;
+    int size()const;
+    bool empty()const;
+    void unite(const VarSet& other);
+    bool intersects(const VarSet& other)const;
+    std::vector<int> difference(const VarSet& other)const; // vars in this set but not in other
+    std::vector<int> to_vector()const;
+    void clear();
+};
+
+#endif